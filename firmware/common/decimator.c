@@ -0,0 +1,229 @@
+/*
+ * Copyright 2017 Great Scott Gadgets
+ *
+ * This file is part of HackRF.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+
+
+#include "decimator.h"
+
+#include <string.h>
+
+#define CIC_ORDER 3
+
+/* Mixer products are scaled to 13 bits signed, leaving room for the CIC's
+ * CIC_ORDER * log2(DECIMATOR_RATIO_MAX) = 18 bits of growth in 32 bits.
+ */
+#define MIXER_SHIFT 11
+#define MIXER_BITS 13
+#define GAIN_BITS 30
+
+/* sin(2 * pi * n / 256) in Q15 */
+static const int16_t sine_q15[256] = {
+	     0,    804,   1608,   2410,   3212,   4011,   4808,   5602,
+	  6393,   7179,   7962,   8739,   9512,  10278,  11039,  11793,
+	 12539,  13279,  14010,  14732,  15446,  16151,  16846,  17530,
+	 18204,  18868,  19519,  20159,  20787,  21403,  22005,  22594,
+	 23170,  23731,  24279,  24811,  25329,  25832,  26319,  26790,
+	 27245,  27683,  28105,  28510,  28898,  29268,  29621,  29956,
+	 30273,  30571,  30852,  31113,  31356,  31580,  31785,  31971,
+	 32137,  32285,  32412,  32521,  32609,  32678,  32728,  32757,
+	 32767,  32757,  32728,  32678,  32609,  32521,  32412,  32285,
+	 32137,  31971,  31785,  31580,  31356,  31113,  30852,  30571,
+	 30273,  29956,  29621,  29268,  28898,  28510,  28105,  27683,
+	 27245,  26790,  26319,  25832,  25329,  24811,  24279,  23731,
+	 23170,  22594,  22005,  21403,  20787,  20159,  19519,  18868,
+	 18204,  17530,  16846,  16151,  15446,  14732,  14010,  13279,
+	 12539,  11793,  11039,  10278,   9512,   8739,   7962,   7179,
+	  6393,   5602,   4808,   4011,   3212,   2410,   1608,    804,
+	     0,   -804,  -1608,  -2410,  -3212,  -4011,  -4808,  -5602,
+	 -6393,  -7179,  -7962,  -8739,  -9512, -10278, -11039, -11793,
+	-12539, -13279, -14010, -14732, -15446, -16151, -16846, -17530,
+	-18204, -18868, -19519, -20159, -20787, -21403, -22005, -22594,
+	-23170, -23731, -24279, -24811, -25329, -25832, -26319, -26790,
+	-27245, -27683, -28105, -28510, -28898, -29268, -29621, -29956,
+	-30273, -30571, -30852, -31113, -31356, -31580, -31785, -31971,
+	-32137, -32285, -32412, -32521, -32609, -32678, -32728, -32757,
+	-32767, -32757, -32728, -32678, -32609, -32521, -32412, -32285,
+	-32137, -31971, -31785, -31580, -31356, -31113, -30852, -30571,
+	-30273, -29956, -29621, -29268, -28898, -28510, -28105, -27683,
+	-27245, -26790, -26319, -25832, -25329, -24811, -24279, -23731,
+	-23170, -22594, -22005, -21403, -20787, -20159, -19519, -18868,
+	-18204, -17530, -16846, -16151, -15446, -14732, -14010, -13279,
+	-12539, -11793, -11039, -10278,  -9512,  -8739,  -7962,  -7179,
+	 -6393,  -5602,  -4808,  -4011,  -3212,  -2410,  -1608,   -804,
+};
+
+bool decimator_configure(
+	decimator_t* const decimator,
+	const uint32_t ratio,
+	const decimator_format_t format,
+	const uint32_t phase_increment
+) {
+	if( (ratio < DECIMATOR_RATIO_MIN) || (ratio > DECIMATOR_RATIO_MAX) ) {
+		return false;
+	}
+	if( (format > DECIMATOR_FORMAT_CS12) || !(DECIMATOR_FORMATS & (1 << format)) ) {
+		return false;
+	}
+
+	memset(decimator, 0, sizeof(*decimator));
+	decimator->ratio = ratio;
+	decimator->format = format;
+	decimator->phase_increment = phase_increment;
+
+	/* CIC gain is ratio^CIC_ORDER. Divide it out as a Q30 multiplier
+	 * and a shift, leaving MIXER_BITS significant bits which are then
+	 * scaled to the output width. */
+	const uint64_t cic_gain = (uint64_t)ratio * ratio * ratio;
+	uint32_t log2_gain = 0;
+	while( ((uint64_t)1 << log2_gain) < cic_gain ) {
+		log2_gain++;
+	}
+	uint32_t output_bits;
+	switch( format ) {
+	case DECIMATOR_FORMAT_CS16:
+		output_bits = 16;
+		break;
+	case DECIMATOR_FORMAT_CS12:
+		output_bits = 12;
+		break;
+	default:
+		output_bits = 8;
+		break;
+	}
+	decimator->gain = (int32_t)(((uint64_t)1 << (GAIN_BITS + log2_gain)) / cic_gain);
+	decimator->shift = GAIN_BITS + log2_gain + MIXER_BITS - output_bits;
+
+	return true;
+}
+
+static inline int32_t decimator_scale(const decimator_t* const decimator, const int32_t value) {
+	return (int32_t)(((int64_t)value * decimator->gain) >> decimator->shift);
+}
+
+static inline int32_t saturate(const int32_t value, const int32_t limit) {
+	return (value >= limit) ? (limit - 1) : (value < -limit) ? -limit : value;
+}
+
+/* Decimate cs8 samples in place. The output is never longer than the
+ * input already consumed, so it is written over it from the start of the
+ * buffer. Returns the number of output bytes.
+ */
+size_t decimator_execute(
+	decimator_t* const decimator,
+	void* const buffer,
+	const size_t length
+) {
+	const int8_t* in = buffer;
+	int8_t* out8 = buffer;
+	int16_t* out16 = buffer;
+	uint8_t* out12 = buffer;
+	const size_t sample_count = length / 2;
+
+	uint32_t phase = decimator->phase;
+	uint32_t count = decimator->count;
+	uint32_t i1 = decimator->integrator_i[0];
+	uint32_t i2 = decimator->integrator_i[1];
+	uint32_t i3 = decimator->integrator_i[2];
+	uint32_t q1 = decimator->integrator_q[0];
+	uint32_t q2 = decimator->integrator_q[1];
+	uint32_t q3 = decimator->integrator_q[2];
+
+	/* Input is read one sample ahead. The first output of a call can
+	 * complete after a single input sample, and in cs16 or cs12 it is
+	 * longer than that sample and overwrites the next one. */
+	int32_t next_i = (sample_count > 0) ? in[0] : 0;
+	int32_t next_q = (sample_count > 0) ? in[1] : 0;
+
+	for(size_t n=0; n<sample_count; n++) {
+		const int32_t i = next_i;
+		const int32_t q = next_q;
+		in += 2;
+		if( (n + 1) < sample_count ) {
+			next_i = in[0];
+			next_q = in[1];
+		}
+
+		/* Multiply by exp(-j * phase) to move the wanted channel to DC. */
+		const uint32_t index = phase >> 24;
+		const int32_t s = sine_q15[index];
+		const int32_t c = sine_q15[(index + 64) & 0xff];
+		phase += decimator->phase_increment;
+
+		/* Integrators wrap, which the combs undo as long as the final
+		 * result fits. */
+		i1 += (uint32_t)((i * c + q * s) >> MIXER_SHIFT);
+		q1 += (uint32_t)((q * c - i * s) >> MIXER_SHIFT);
+		i2 += i1;
+		q2 += q1;
+		i3 += i2;
+		q3 += q2;
+
+		if( ++count < decimator->ratio ) {
+			continue;
+		}
+		count = 0;
+
+		uint32_t ui = i3;
+		uint32_t uq = q3;
+		for(uint_fast8_t k=0; k<CIC_ORDER; k++) {
+			const uint32_t di = ui - decimator->comb_i[k];
+			const uint32_t dq = uq - decimator->comb_q[k];
+			decimator->comb_i[k] = ui;
+			decimator->comb_q[k] = uq;
+			ui = di;
+			uq = dq;
+		}
+
+		const int32_t ci = decimator_scale(decimator, (int32_t)ui);
+		const int32_t cq = decimator_scale(decimator, (int32_t)uq);
+		if( decimator->format == DECIMATOR_FORMAT_CS16 ) {
+			*(out16++) = saturate(ci, 0x8000);
+			*(out16++) = saturate(cq, 0x8000);
+		} else if( decimator->format == DECIMATOR_FORMAT_CS12 ) {
+			const uint32_t packed =
+				  ((uint32_t)saturate(ci, 0x800) & 0xfff)
+				| (((uint32_t)saturate(cq, 0x800) & 0xfff) << 12);
+			*(out12++) = packed & 0xff;
+			*(out12++) = (packed >> 8) & 0xff;
+			*(out12++) = (packed >> 16) & 0xff;
+		} else {
+			*(out8++) = saturate(ci, 0x80);
+			*(out8++) = saturate(cq, 0x80);
+		}
+	}
+
+	decimator->phase = phase;
+	decimator->count = count;
+	decimator->integrator_i[0] = i1;
+	decimator->integrator_i[1] = i2;
+	decimator->integrator_i[2] = i3;
+	decimator->integrator_q[0] = q1;
+	decimator->integrator_q[1] = q2;
+	decimator->integrator_q[2] = q3;
+
+	switch( decimator->format ) {
+	case DECIMATOR_FORMAT_CS16:
+		return (uint8_t*)out16 - (uint8_t*)buffer;
+	case DECIMATOR_FORMAT_CS12:
+		return out12 - (uint8_t*)buffer;
+	default:
+		return (uint8_t*)out8 - (uint8_t*)buffer;
+	}
+}
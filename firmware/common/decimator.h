@@ -0,0 +1,85 @@
+/*
+ * Copyright 2017 Great Scott Gadgets
+ *
+ * This file is part of HackRF.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+
+
+#ifndef __DECIMATOR_H__
+#define __DECIMATOR_H__
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#define DECIMATOR_RATIO_MIN 2
+#define DECIMATOR_RATIO_MAX 64
+
+/* decimator_execute() costs a little over 20 CPU cycles per input sample
+ * whatever the ratio or format. Together with the SGPIO and USB interrupts
+ * that is all the main loop can spare at 204 MHz above this rate, and the
+ * sample ring would overrun.
+ */
+#define DECIMATOR_MAX_INPUT_RATE_HZ 5000000
+
+typedef enum {
+	DECIMATOR_FORMAT_CS8 = 0,
+	DECIMATOR_FORMAT_CS16 = 1,
+	/* I and Q as 12-bit values packed little-endian into 3 bytes:
+	 * (I & 0xfff) | ((Q & 0xfff) << 12) */
+	DECIMATOR_FORMAT_CS12 = 2,
+} decimator_format_t;
+
+#define DECIMATOR_FORMATS ( \
+	  (1 << DECIMATOR_FORMAT_CS8) \
+	| (1 << DECIMATOR_FORMAT_CS16) \
+	| (1 << DECIMATOR_FORMAT_CS12) \
+	)
+
+/* NCO followed by a third order CIC decimator, all in fixed point. The
+ * NCO shifts the signal at phase_increment / 2^32 of the sample rate down
+ * to DC before decimation.
+ */
+typedef struct {
+	uint32_t ratio;
+	decimator_format_t format;
+	uint32_t phase;
+	uint32_t phase_increment;
+	uint32_t count;
+	int32_t gain;
+	uint32_t shift;
+	uint32_t integrator_i[3];
+	uint32_t integrator_q[3];
+	uint32_t comb_i[3];
+	uint32_t comb_q[3];
+} decimator_t;
+
+bool decimator_configure(
+	decimator_t* const decimator,
+	const uint32_t ratio,
+	const decimator_format_t format,
+	const uint32_t phase_increment
+);
+
+size_t decimator_execute(
+	decimator_t* const decimator,
+	void* const buffer,
+	const size_t length
+);
+
+#endif/*__DECIMATOR_H__*/
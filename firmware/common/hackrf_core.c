@@ -131,6 +131,8 @@ i2c_bus_t i2c0 = {
 	.start = i2c_lpc_start,
 	.stop = i2c_lpc_stop,
 	.transfer = i2c_lpc_transfer,
+	.submit = i2c_lpc_submit,
+	.wait = i2c_lpc_wait,
 };
 
 i2c_bus_t i2c1 = {
@@ -138,6 +140,8 @@ i2c_bus_t i2c1 = {
 	.start = i2c_lpc_start,
 	.stop = i2c_lpc_stop,
 	.transfer = i2c_lpc_transfer,
+	.submit = i2c_lpc_submit,
+	.wait = i2c_lpc_wait,
 };
 
 const i2c_lpc_config_t i2c_config_si5351c_slow_clock = {
@@ -320,6 +324,14 @@ gcd(uint32_t u, uint32_t v)
 	return u << s;
 }
 
+static uint32_t current_sample_rate_hz;
+
+/* Sample rate last set, in Hz, rounded down. */
+uint32_t sample_rate_get(void)
+{
+	return current_sample_rate_hz;
+}
+
 bool sample_rate_frac_set(uint32_t rate_num, uint32_t rate_denom)
 {
 	const uint64_t VCO_FREQ = 800 * 1000 * 1000; /* 800 MHz */
@@ -328,6 +340,9 @@ bool sample_rate_frac_set(uint32_t rate_num, uint32_t rate_denom)
 	uint32_t rem;
 
 	hackrf_ui_setSampleRate(rate_num/2);
+	if (rate_denom) {
+		current_sample_rate_hz = rate_num / 2 / rate_denom;
+	}
 
 	/* Find best config */
 	a = (VCO_FREQ * rate_denom) / rate_num;
@@ -432,6 +447,7 @@ bool sample_rate_set(const uint32_t sample_rate_hz) {
 	default:
 		return false;
 	}
+	current_sample_rate_hz = sample_rate_hz;
 	
 	/* MS0/CLK0 is the source for the MAX5864/CPLD (CODEC_CLK). */
 	si5351c_configure_multisynth(&clock_gen, 0, p1, p2, p3, 1);
@@ -445,6 +461,59 @@ bool sample_rate_set(const uint32_t sample_rate_hz) {
 	return true;
 }
 
+/*
+ * Sample rate in Hz, rounded down, that sample_rate_multisynth_set() would
+ * give for these parameters, or 0 if they are out of range.
+ */
+uint32_t sample_rate_multisynth_hz(const uint32_t p1, const uint32_t p2,
+		const uint32_t p3, const uint32_t r_div)
+{
+	if ((p1 >= (1 << 18)) || (p2 >= (1 << 20)) || (p3 >= (1 << 20))
+			|| (p3 == 0) || (p2 >= p3) || (r_div > 6)) {
+		return 0;
+	}
+
+	/* P1 + 512 is 128 * (a + b/c) rounded down. */
+	const uint64_t divider_x128 = p1 + 512;
+	if (divider_x128 < (8 * 128)) {
+		return 0;
+	}
+	return (800ULL * 1000 * 1000 * 128 * p3)
+		/ ((divider_x128 * p3 + p2) << (r_div + 1));
+}
+
+/*
+ * Program MS0 with multisynth parameters worked out by the host. r_div
+ * is the extra R divider (as a power of two) applied to all three clocks,
+ * CLK0 always runs at half the rate of CLK1 and CLK2. Integer mode is
+ * used whenever the divider allows it.
+ */
+bool sample_rate_multisynth_set(const uint32_t p1, const uint32_t p2,
+		const uint32_t p3, const uint32_t r_div)
+{
+	const uint32_t rate = sample_rate_multisynth_hz(p1, p2, p3, r_div);
+	if (rate == 0) {
+		return false;
+	}
+	hackrf_ui_setSampleRate(rate);
+	current_sample_rate_hz = rate;
+
+	const uint64_t divider_x128 = p1 + 512;
+	const bool int_mode = (p2 == 0) && ((divider_x128 % 256) == 0);
+	si5351c_set_int_mode(&clock_gen, 0, int_mode ? 1 : 0);
+
+	/* MS0/CLK0 is the source for the MAX5864/CPLD (CODEC_CLK). */
+	si5351c_configure_multisynth(&clock_gen, 0, p1, p2, p3, r_div + 1);
+
+	/* MS0/CLK1 is the source for the CPLD (CODEC_X2_CLK). */
+	si5351c_configure_multisynth(&clock_gen, 1, 0, 0, 0, r_div);//p1 doesn't matter
+
+	/* MS0/CLK2 is the source for SGPIO (CODEC_X2_CLK) */
+	si5351c_configure_multisynth(&clock_gen, 2, 0, 0, 0, r_div);//p1 doesn't matter
+
+	return true;
+}
+
 bool baseband_filter_bandwidth_set(const uint32_t bandwidth_hz) {
 	uint32_t bandwidth_hz_real = max2837_set_lpf_bandwidth(&max2837, bandwidth_hz);
 
@@ -237,7 +237,8 @@ typedef enum {
 	TRANSCEIVER_MODE_RX = 1,
 	TRANSCEIVER_MODE_TX = 2,
 	TRANSCEIVER_MODE_SS = 3,
-	TRANSCEIVER_MODE_CPLD_UPDATE = 4
+	TRANSCEIVER_MODE_CPLD_UPDATE = 4,
+	TRANSCEIVER_MODE_TX_ECHO = 5
 } transceiver_mode_t;
 
 typedef enum {
@@ -275,6 +276,11 @@ void disable_1v8_power(void);
 
 bool sample_rate_frac_set(uint32_t rate_num, uint32_t rate_denom);
 bool sample_rate_set(const uint32_t sampling_rate_hz);
+uint32_t sample_rate_get(void);
+uint32_t sample_rate_multisynth_hz(const uint32_t p1, const uint32_t p2,
+		const uint32_t p3, const uint32_t r_div);
+bool sample_rate_multisynth_set(const uint32_t p1, const uint32_t p2,
+		const uint32_t p3, const uint32_t r_div);
 bool baseband_filter_bandwidth_set(const uint32_t bandwidth_hz);
 
 #if (defined HACKRF_ONE || defined RAD1O)
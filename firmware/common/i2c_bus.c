@@ -29,11 +29,19 @@ void i2c_bus_stop(i2c_bus_t* const bus) {
 	bus->stop(bus);
 }
 
-void i2c_bus_transfer(
+i2c_status_t i2c_bus_transfer(
 	i2c_bus_t* const bus,
 	const uint_fast8_t slave_address,
 	const uint8_t* const tx, const size_t tx_count,
 	uint8_t* const rx, const size_t rx_count
 ) {
-	bus->transfer(bus, slave_address, tx, tx_count, rx, rx_count);
+	return bus->transfer(bus, slave_address, tx, tx_count, rx, rx_count);
+}
+
+void i2c_bus_submit(i2c_bus_t* const bus, i2c_transaction_t* const transaction) {
+	bus->submit(bus, transaction);
+}
+
+i2c_status_t i2c_bus_wait(i2c_bus_t* const bus, i2c_transaction_t* const transaction) {
+	return bus->wait(bus, transaction);
 }
@@ -28,25 +28,62 @@
 struct i2c_bus_t;
 typedef struct i2c_bus_t i2c_bus_t;
 
+typedef enum {
+	I2C_STATUS_OK = 0,
+	I2C_STATUS_BUSY = 1,
+	I2C_STATUS_NACK = 2,
+	I2C_STATUS_ARBITRATION_LOST = 3,
+	I2C_STATUS_BUS_ERROR = 4,
+} i2c_status_t;
+
+struct i2c_transaction_t;
+typedef struct i2c_transaction_t i2c_transaction_t;
+
+/*
+ * A queued transfer: tx_count bytes written, then (after a repeated
+ * START) rx_count bytes read. The buffers and the transaction itself
+ * belong to the caller until status leaves I2C_STATUS_BUSY. The
+ * callback, if any, runs from the I2C interrupt.
+ */
+struct i2c_transaction_t {
+	uint_fast8_t slave_address;
+	const uint8_t* tx;
+	size_t tx_count;
+	uint8_t* rx;
+	size_t rx_count;
+	void (*callback)(i2c_transaction_t* const transaction);
+	void* user_data;
+	volatile i2c_status_t status;
+	i2c_transaction_t* next;
+};
+
 struct i2c_bus_t {
 	void* const obj;
 	void (*start)(i2c_bus_t* const bus, const void* const config);
 	void (*stop)(i2c_bus_t* const bus);
-	void (*transfer)(
+	i2c_status_t (*transfer)(
 		i2c_bus_t* const bus,
 		const uint_fast8_t slave_address,
 		const uint8_t* const tx, const size_t tx_count,
 		uint8_t* const rx, const size_t rx_count
 	);
+	void (*submit)(i2c_bus_t* const bus, i2c_transaction_t* const transaction);
+	i2c_status_t (*wait)(i2c_bus_t* const bus, i2c_transaction_t* const transaction);
 };
 
 void i2c_bus_start(i2c_bus_t* const bus, const void* const config);
 void i2c_bus_stop(i2c_bus_t* const bus);
-void i2c_bus_transfer(
+i2c_status_t i2c_bus_transfer(
 	i2c_bus_t* const bus,
 	const uint_fast8_t slave_address,
 	const uint8_t* const tx, const size_t tx_count,
 	uint8_t* const rx, const size_t rx_count
 );
 
+/* Queue a transaction and return without waiting for the bus. */
+void i2c_bus_submit(i2c_bus_t* const bus, i2c_transaction_t* const transaction);
+
+/* Block until a submitted transaction completes, return its status. */
+i2c_status_t i2c_bus_wait(i2c_bus_t* const bus, i2c_transaction_t* const transaction);
+
 #endif/*__I2C_BUS_H__*/
@@ -22,47 +22,258 @@
 
 #include "i2c_lpc.h"
 
+#include <stdbool.h>
+
+#include <libopencm3/cm3/cortex.h>
+#include <libopencm3/cm3/vector.h>
 #include <libopencm3/lpc43xx/i2c.h>
+#include <libopencm3/lpc43xx/m4/nvic.h>
+
+/*
+ * Transactions are queued per port and driven one state at a time from
+ * the I2C interrupt, so a caller can start a write and carry on (e.g.
+ * with PLL settling) while the bytes go out. Blocking transfers use the
+ * same queue and poll SI, so they also work from an interrupt handler the
+ * I2C interrupt can't preempt.
+ *
+ * The queue is used from the main loop and from interrupt handlers (USB
+ * requests retune and set the sample rate). Every queue update and every
+ * bus state step runs with PRIMASK set, saved and restored so that it
+ * nests, which makes each step atomic whichever context drives it.
+ */
+
+/* Master mode states from I2STAT. */
+#define I2C_STAT_START           0x08
+#define I2C_STAT_REPEATED_START  0x10
+#define I2C_STAT_SLA_W_ACK       0x18
+#define I2C_STAT_SLA_W_NACK      0x20
+#define I2C_STAT_DATA_TX_ACK     0x28
+#define I2C_STAT_DATA_TX_NACK    0x30
+#define I2C_STAT_ARBITRATION     0x38
+#define I2C_STAT_SLA_R_ACK       0x40
+#define I2C_STAT_SLA_R_NACK      0x48
+#define I2C_STAT_DATA_RX_ACK     0x50
+#define I2C_STAT_DATA_RX_NACK    0x58
+#define I2C_STAT_BUS_ERROR       0x00
+
+typedef struct i2c_lpc_queue_t {
+	i2c_transaction_t* head;
+	i2c_transaction_t* tail;
+	size_t index;
+	bool reading;
+} i2c_lpc_queue_t;
+
+static i2c_lpc_queue_t i2c_lpc_queue[2];
+
+static i2c_lpc_queue_t* i2c_lpc_queue_for(const uint32_t port) {
+	return &i2c_lpc_queue[(port == I2C0_BASE) ? 0 : 1];
+}
+
+static uint8_t i2c_lpc_irq(const uint32_t port) {
+	return (port == I2C0_BASE) ? NVIC_I2C0_IRQ : NVIC_I2C1_IRQ;
+}
+
+static void i2c_lpc_begin(const uint32_t port, i2c_lpc_queue_t* const queue) {
+	const i2c_transaction_t* const transaction = queue->head;
+	queue->index = 0;
+	queue->reading = !(transaction->tx && (transaction->tx_count > 0));
+	I2C_CONSET(port) = I2C_CONSET_STA;
+}
+
+static void i2c_lpc_finish(const uint32_t port, i2c_lpc_queue_t* const queue,
+		const i2c_status_t status) {
+	i2c_transaction_t* const transaction = queue->head;
+
+	queue->head = transaction->next;
+	if (queue->head == NULL) {
+		queue->tail = NULL;
+	}
+
+	/* After lost arbitration the bus belongs to someone else, so
+	 * release it without a STOP. A queued START is sent once the bus
+	 * is free. */
+	I2C_CONCLR(port) = I2C_CONCLR_STAC | I2C_CONCLR_AAC;
+	if (status != I2C_STATUS_ARBITRATION_LOST) {
+		I2C_CONSET(port) = I2C_CONSET_STO;
+	}
+	if (queue->head) {
+		i2c_lpc_begin(port, queue);
+	}
+	I2C_CONCLR(port) = I2C_CONCLR_SIC;
+
+	transaction->next = NULL;
+	transaction->status = status;
+	if (transaction->callback) {
+		transaction->callback(transaction);
+	}
+}
+
+/* Advance the current transaction by one bus state. Interrupts must be
+ * masked. */
+static void i2c_lpc_step(const uint32_t port) {
+	i2c_lpc_queue_t* const queue = i2c_lpc_queue_for(port);
+	i2c_transaction_t* const transaction = queue->head;
+
+	if (!(I2C_CONSET(port) & I2C_CONSET_SI)) {
+		return;
+	}
+	if (transaction == NULL) {
+		I2C_CONCLR(port) = I2C_CONCLR_SIC;
+		return;
+	}
+
+	const uint32_t state = I2C_STAT(port) & 0xf8;
+	switch (state) {
+	case I2C_STAT_START:
+	case I2C_STAT_REPEATED_START:
+		I2C_DAT(port) = (transaction->slave_address << 1)
+			| (queue->reading ? I2C_READ : I2C_WRITE);
+		I2C_CONCLR(port) = I2C_CONCLR_STAC | I2C_CONCLR_SIC;
+		break;
+
+	case I2C_STAT_SLA_W_ACK:
+	case I2C_STAT_DATA_TX_ACK:
+		if (queue->index < transaction->tx_count) {
+			I2C_DAT(port) = transaction->tx[queue->index++];
+			I2C_CONCLR(port) = I2C_CONCLR_SIC;
+		} else if (transaction->rx && (transaction->rx_count > 0)) {
+			queue->index = 0;
+			queue->reading = true;
+			I2C_CONSET(port) = I2C_CONSET_STA;
+			I2C_CONCLR(port) = I2C_CONCLR_SIC;
+		} else {
+			i2c_lpc_finish(port, queue, I2C_STATUS_OK);
+		}
+		break;
+
+	case I2C_STAT_SLA_R_ACK:
+	case I2C_STAT_DATA_RX_ACK:
+		if (state == I2C_STAT_DATA_RX_ACK) {
+			transaction->rx[queue->index++] = I2C_DAT(port);
+		}
+		/* ACK each byte except the last */
+		if ((transaction->rx_count - queue->index) > 1) {
+			I2C_CONSET(port) = I2C_CONSET_AA;
+		} else {
+			I2C_CONCLR(port) = I2C_CONCLR_AAC;
+		}
+		I2C_CONCLR(port) = I2C_CONCLR_SIC;
+		break;
+
+	case I2C_STAT_DATA_RX_NACK:
+		transaction->rx[queue->index++] = I2C_DAT(port);
+		i2c_lpc_finish(port, queue, I2C_STATUS_OK);
+		break;
+
+	case I2C_STAT_SLA_W_NACK:
+	case I2C_STAT_DATA_TX_NACK:
+	case I2C_STAT_SLA_R_NACK:
+		i2c_lpc_finish(port, queue, I2C_STATUS_NACK);
+		break;
+
+	case I2C_STAT_ARBITRATION:
+		i2c_lpc_finish(port, queue, I2C_STATUS_ARBITRATION_LOST);
+		break;
+
+	case I2C_STAT_BUS_ERROR:
+	default:
+		i2c_lpc_finish(port, queue, I2C_STATUS_BUS_ERROR);
+		break;
+	}
+}
+
+static void i2c_lpc_service(const uint32_t port) {
+	const uint32_t primask = cm_mask_interrupts(1);
+	i2c_lpc_step(port);
+	cm_mask_interrupts(primask);
+}
+
+static void i2c0_isr(void) {
+	i2c_lpc_service(I2C0_BASE);
+}
 
-/* FIXME return i2c0 status from each function */
+static void i2c1_isr(void) {
+	i2c_lpc_service(I2C1_BASE);
+}
 
 void i2c_lpc_start(i2c_bus_t* const bus, const void* const _config) {
 	const i2c_lpc_config_t* const config = _config;
 
 	const uint32_t port = (uint32_t)bus->obj;
+	const uint8_t irq = i2c_lpc_irq(port);
+	i2c_lpc_queue_t* const queue = i2c_lpc_queue_for(port);
+
+	nvic_disable_irq(irq);
+	queue->head = NULL;
+	queue->tail = NULL;
 	i2c_init(port, config->duty_cycle_count);
+
+	vector_table.irq[irq] = (port == I2C0_BASE) ? i2c0_isr : i2c1_isr;
+	nvic_enable_irq(irq);
 }
 
 void i2c_lpc_stop(i2c_bus_t* const bus) {
 	const uint32_t port = (uint32_t)bus->obj;
+	nvic_disable_irq(i2c_lpc_irq(port));
 	i2c_disable(port);
 }
 
-void i2c_lpc_transfer(i2c_bus_t* const bus,
-	const uint_fast8_t slave_address,
-	const uint8_t* const data_tx, const size_t count_tx,
-	uint8_t* const data_rx, const size_t count_rx
-) {
+void i2c_lpc_submit(i2c_bus_t* const bus, i2c_transaction_t* const transaction) {
 	const uint32_t port = (uint32_t)bus->obj;
-	size_t i;
-	bool ack = false;
-	if (data_tx && (count_tx > 0)) {
-		i2c_tx_start(port);
-		i2c_tx_byte(port, (slave_address << 1) | I2C_WRITE);
-		for(i=0; i<count_tx; i++) {
-			i2c_tx_byte(port, data_tx[i]);
+	i2c_lpc_queue_t* const queue = i2c_lpc_queue_for(port);
+
+	transaction->next = NULL;
+	if (!(transaction->tx && transaction->tx_count)
+			&& !(transaction->rx && transaction->rx_count)) {
+		transaction->status = I2C_STATUS_OK;
+		if (transaction->callback) {
+			transaction->callback(transaction);
 		}
+		return;
 	}
+	transaction->status = I2C_STATUS_BUSY;
 
-	if (data_rx && (count_rx > 0)) {
-		i2c_tx_start(port);
-		i2c_tx_byte(port, (slave_address << 1) | I2C_READ);
-		for(i=0; i<count_rx; i++) {
-			/* ACK each byte except the last */
-			ack = (i!=count_rx-1);
-			data_rx[i] = i2c_rx_byte(port, ack);
-		}
+	const uint32_t primask = cm_mask_interrupts(1);
+	if (queue->tail) {
+		queue->tail->next = transaction;
+		queue->tail = transaction;
+	} else {
+		queue->head = transaction;
+		queue->tail = transaction;
+		i2c_lpc_begin(port, queue);
+	}
+	cm_mask_interrupts(primask);
+}
+
+i2c_status_t i2c_lpc_wait(i2c_bus_t* const bus, i2c_transaction_t* const transaction) {
+	const uint32_t port = (uint32_t)bus->obj;
+
+	/* Poll rather than sleep: the caller may itself be an interrupt
+	 * handler that the I2C interrupt cannot preempt. Each step is taken
+	 * with interrupts masked, so if the I2C interrupt does run it and
+	 * this loop never act on the same SI. */
+	while (transaction->status == I2C_STATUS_BUSY) {
+		i2c_lpc_service(port);
 	}
 
-	i2c_stop(port);
+	return transaction->status;
+}
+
+i2c_status_t i2c_lpc_transfer(i2c_bus_t* const bus,
+	const uint_fast8_t slave_address,
+	const uint8_t* const data_tx, const size_t count_tx,
+	uint8_t* const data_rx, const size_t count_rx
+) {
+	i2c_transaction_t transaction = {
+		.slave_address = slave_address,
+		.tx = data_tx,
+		.tx_count = count_tx,
+		.rx = data_rx,
+		.rx_count = count_rx,
+		.callback = NULL,
+		.user_data = NULL,
+	};
+
+	i2c_lpc_submit(bus, &transaction);
+	return i2c_lpc_wait(bus, &transaction);
 }
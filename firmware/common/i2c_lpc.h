@@ -33,10 +33,12 @@ typedef struct i2c_lpc_config_t {
 
 void i2c_lpc_start(i2c_bus_t* const bus, const void* const config);
 void i2c_lpc_stop(i2c_bus_t* const bus);
-void i2c_lpc_transfer(i2c_bus_t* const bus,
+i2c_status_t i2c_lpc_transfer(i2c_bus_t* const bus,
 	const uint_fast8_t slave_address,
 	const uint8_t* const data_tx, const size_t count_tx,
 	uint8_t* const data_rx, const size_t count_rx
 );
+void i2c_lpc_submit(i2c_bus_t* const bus, i2c_transaction_t* const transaction);
+i2c_status_t i2c_lpc_wait(i2c_bus_t* const bus, i2c_transaction_t* const transaction);
 
 #endif/*__I2C_LPC_H__*/
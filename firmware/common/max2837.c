@@ -160,6 +160,17 @@ void max2837_regs_commit(max2837_driver_t* const drv)
 	}
 }
 
+void max2837_regs_commit_ordered(max2837_driver_t* const drv,
+		const uint8_t* const regs, const size_t count)
+{
+	size_t i;
+	for(i = 0; i < count; i++) {
+		if ((drv->regs_dirty >> regs[i]) & 0x1) {
+			max2837_reg_commit(drv, regs[i]);
+		}
+	}
+}
+
 void max2837_set_mode(max2837_driver_t* const drv, const max2837_mode_t new_mode) {
 	drv->set_mode(drv, new_mode);
 }
@@ -196,62 +207,119 @@ void max2837_stop(max2837_driver_t* const drv)
 	max2837_set_mode(drv, MAX2837_MODE_SHUTDOWN);
 }
 
-void max2837_set_frequency(max2837_driver_t* const drv, uint32_t freq)
+/*
+ * The fractional divider has always been produced by a bit-serial loop
+ * that compares the remainder against 30 MHz halved and truncated twenty
+ * times. The result is the largest 20-bit FRAC whose sum of those
+ * truncated steps is below the remainder. The top seven steps are exact
+ * multiples of 30 MHz / 2^7, the bottom thirteen are summed from these
+ * tables, which gives the same FRAC with a couple of divides.
+ */
+#define MAX2837_FRAC_STEP 234375 /* 30 MHz / 2^7 */
+
+/* Sum of the truncated steps for FRAC bits 12..7 and 6..0. */
+static const uint32_t max2837_frac_sum_hi[64] = {
+	     0,   3662,   7324,  10986,  14648,  18310,  21972,  25634,
+	 29296,  32958,  36620,  40282,  43944,  47606,  51268,  54930,
+	 58593,  62255,  65917,  69579,  73241,  76903,  80565,  84227,
+	 87889,  91551,  95213,  98875, 102537, 106199, 109861, 113523,
+	117187, 120849, 124511, 128173, 131835, 135497, 139159, 142821,
+	146483, 150145, 153807, 157469, 161131, 164793, 168455, 172117,
+	175780, 179442, 183104, 186766, 190428, 194090, 197752, 201414,
+	205076, 208738, 212400, 216062, 219724, 223386, 227048, 230710,
+};
+
+static const uint32_t max2837_frac_sum_lo[128] = {
+	     0,     28,     57,     85,    114,    142,    171,    199,
+	   228,    256,    285,    313,    342,    370,    399,    427,
+	   457,    485,    514,    542,    571,    599,    628,    656,
+	   685,    713,    742,    770,    799,    827,    856,    884,
+	   915,    943,    972,   1000,   1029,   1057,   1086,   1114,
+	  1143,   1171,   1200,   1228,   1257,   1285,   1314,   1342,
+	  1372,   1400,   1429,   1457,   1486,   1514,   1543,   1571,
+	  1600,   1628,   1657,   1685,   1714,   1742,   1771,   1799,
+	  1831,   1859,   1888,   1916,   1945,   1973,   2002,   2030,
+	  2059,   2087,   2116,   2144,   2173,   2201,   2230,   2258,
+	  2288,   2316,   2345,   2373,   2402,   2430,   2459,   2487,
+	  2516,   2544,   2573,   2601,   2630,   2658,   2687,   2715,
+	  2746,   2774,   2803,   2831,   2860,   2888,   2917,   2945,
+	  2974,   3002,   3031,   3059,   3088,   3116,   3145,   3173,
+	  3203,   3231,   3260,   3288,   3317,   3345,   3374,   3402,
+	  3431,   3459,   3488,   3516,   3545,   3573,   3602,   3630,
+};
+
+static uint32_t max2837_frac_sum(const uint32_t frac_low) {
+	return max2837_frac_sum_hi[frac_low >> 7] + max2837_frac_sum_lo[frac_low & 0x7f];
+}
+
+static uint32_t max2837_compute_frac(const uint32_t div_rem)
 {
-	uint8_t band;
-	uint8_t lna_band;
-	uint32_t div_frac;
-	uint32_t div_int;
-	uint32_t div_rem;
-	uint32_t div_cmp;
-	int i;
+	if (div_rem == 0) {
+		return 0;
+	}
 
+	const uint32_t frac_high = (div_rem - 1) / MAX2837_FRAC_STEP;
+	const uint32_t rem = div_rem - (frac_high * MAX2837_FRAC_STEP);
+
+	/* Truncation only ever makes the steps smaller, so this estimate
+	 * is at most one short. */
+	uint32_t frac_low = ((rem - 1) << 13) / MAX2837_FRAC_STEP;
+	while ((frac_low < 0x1fff) && (max2837_frac_sum(frac_low + 1) < rem)) {
+		frac_low++;
+	}
+
+	return (frac_high << 13) | frac_low;
+}
+
+void max2837_compute_frequency(max2837_freq_config_t* const cfg, uint32_t freq)
+{
 	/* Select band. Allow tuning outside specified bands. */
 	if (freq < 2400000000U) {
-		band = MAX2837_LOGEN_BSW_2_3;
-		lna_band = MAX2837_LNAband_2_4;
+		cfg->band = MAX2837_LOGEN_BSW_2_3;
+		cfg->lna_band = MAX2837_LNAband_2_4;
 	}
 	else if (freq < 2500000000U) {
-		band = MAX2837_LOGEN_BSW_2_4;
-		lna_band = MAX2837_LNAband_2_4;
+		cfg->band = MAX2837_LOGEN_BSW_2_4;
+		cfg->lna_band = MAX2837_LNAband_2_4;
 	}
 	else if (freq < 2600000000U) {
-		band = MAX2837_LOGEN_BSW_2_5;
-		lna_band = MAX2837_LNAband_2_6;
+		cfg->band = MAX2837_LOGEN_BSW_2_5;
+		cfg->lna_band = MAX2837_LNAband_2_6;
 	}
 	else {
-		band = MAX2837_LOGEN_BSW_2_6;
-		lna_band = MAX2837_LNAband_2_6;
+		cfg->band = MAX2837_LOGEN_BSW_2_6;
+		cfg->lna_band = MAX2837_LNAband_2_6;
 	}
 
 	/* ASSUME 40MHz PLL. Ratio = F*(4/3)/40,000,000 = F/30,000,000 */
-	div_int = freq / 30000000;
-	div_rem = freq % 30000000;
-	div_frac = 0;
-	div_cmp = 30000000;
-	for( i = 0; i < 20; i++) {
-		div_frac <<= 1;
-		div_cmp >>= 1;
-		if (div_rem > div_cmp) {
-			div_frac |= 0x1;
-			div_rem -= div_cmp;
-		}
-	}
+	cfg->div_int = freq / 30000000;
+	cfg->div_frac = max2837_compute_frac(freq % 30000000);
+}
+
+/* LNAband is in register 0, INT and LOGEN_BSW share register 19. FRAC_LO
+ * has to go last, it is the trigger for VCO auto-select. */
+static const uint8_t max2837_frequency_regs[] = { 0, 19, 18, 17 };
 
+void max2837_set_frequency_config(max2837_driver_t* const drv,
+		const max2837_freq_config_t* const cfg)
+{
 	/* Band settings */
-	set_MAX2837_LOGEN_BSW(drv, band);
-	set_MAX2837_LNAband(drv, lna_band);
-
-	/* Write order matters here, so commit INT and FRAC_HI before
-	 * committing FRAC_LO, which is the trigger for VCO
-	 * auto-select. TODO - it's cleaner this way, but it would be
-	 * faster to explicitly commit the registers explicitly so the
-	 * dirty bits aren't scanned twice. */
-	set_MAX2837_SYN_INT(drv, div_int);
-	set_MAX2837_SYN_FRAC_HI(drv, (div_frac >> 10) & 0x3ff);
-	max2837_regs_commit(drv);
-	set_MAX2837_SYN_FRAC_LO(drv, div_frac & 0x3ff);
-	max2837_regs_commit(drv);
+	set_MAX2837_LOGEN_BSW(drv, cfg->band);
+	set_MAX2837_LNAband(drv, cfg->lna_band);
+
+	set_MAX2837_SYN_INT(drv, cfg->div_int);
+	set_MAX2837_SYN_FRAC_HI(drv, (cfg->div_frac >> 10) & 0x3ff);
+	set_MAX2837_SYN_FRAC_LO(drv, cfg->div_frac & 0x3ff);
+	max2837_regs_commit_ordered(drv, max2837_frequency_regs,
+			sizeof(max2837_frequency_regs));
+}
+
+void max2837_set_frequency(max2837_driver_t* const drv, uint32_t freq)
+{
+	max2837_freq_config_t cfg;
+
+	max2837_compute_frequency(&cfg, freq);
+	max2837_set_frequency_config(drv, &cfg);
 }
 
 typedef struct {
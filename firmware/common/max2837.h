@@ -23,6 +23,7 @@
 #ifndef __MAX2837_H
 #define __MAX2837_H
 
+#include <stddef.h>
 #include <stdint.h>
 #include <stdbool.h>
 
@@ -55,6 +56,15 @@ struct max2837_driver_t {
 	uint32_t regs_dirty;
 };
 
+/* Synthesizer and band settings for one frequency, computed ahead of
+ * time so that retuning only has to write registers. */
+typedef struct {
+	uint8_t band;
+	uint8_t lna_band;
+	uint8_t div_int;
+	uint32_t div_frac;
+} max2837_freq_config_t;
+
 /* Initialize chip. */
 extern void max2837_setup(max2837_driver_t* const drv);
 
@@ -71,6 +81,11 @@ extern void max2837_reg_write(max2837_driver_t* const drv, uint8_t r, uint16_t v
  * provided routines for those operations. */
 extern void max2837_regs_commit(max2837_driver_t* const drv);
 
+/* Write the listed registers via SPI, in the order given, skipping any
+ * that are already clean. Mark them clean. */
+extern void max2837_regs_commit_ordered(max2837_driver_t* const drv,
+		const uint8_t* const regs, const size_t count);
+
 max2837_mode_t max2837_mode(max2837_driver_t* const drv);
 void max2837_set_mode(max2837_driver_t* const drv, const max2837_mode_t new_mode);
 
@@ -81,6 +96,9 @@ extern void max2837_stop(max2837_driver_t* const drv);
 /* Set frequency in Hz. Frequency setting is a multi-step function
  * where order of register writes matters. */
 extern void max2837_set_frequency(max2837_driver_t* const drv, uint32_t freq);
+extern void max2837_compute_frequency(max2837_freq_config_t* const cfg, uint32_t freq);
+extern void max2837_set_frequency_config(max2837_driver_t* const drv,
+		const max2837_freq_config_t* const cfg);
 uint32_t max2837_set_lpf_bandwidth(max2837_driver_t* const drv, const uint32_t bandwidth_hz);
 bool max2837_set_lna_gain(max2837_driver_t* const drv, const uint32_t gain_db);
 bool max2837_set_vga_gain(max2837_driver_t* const drv, const uint32_t gain_db);
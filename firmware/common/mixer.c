@@ -72,13 +72,48 @@ void mixer_setup(mixer_driver_t* const mixer)
 #endif
 }
 
-uint64_t mixer_set_frequency(mixer_driver_t* const mixer, uint16_t mhz)
+uint64_t mixer_set_frequency(mixer_driver_t* const mixer, uint64_t hz)
 {
 #if (defined JAWBREAKER || defined HACKRF_ONE)
-	return rffc5071_set_frequency(mixer, mhz);
+	return rffc5071_set_frequency_hz(mixer, hz);
 #endif
 #ifdef RAD1O
-	return max2871_set_frequency(mixer, mhz);
+	return max2871_set_frequency(mixer, hz / 1000000);
+#endif
+}
+
+void mixer_compute_frequency(mixer_config_t* const cfg, uint64_t hz)
+{
+#if (defined JAWBREAKER || defined HACKRF_ONE)
+	rffc5071_compute_synth(cfg, hz);
+#endif
+#ifdef RAD1O
+	/* max2871_set_frequency() tunes in 40 MHz steps */
+	cfg->mhz = hz / 1000000;
+	cfg->freq_hz = (uint64_t)(cfg->mhz / 40) * 40 * 1000000;
+#endif
+}
+
+void mixer_set_frequency_config(mixer_driver_t* const mixer,
+		const mixer_config_t* const cfg)
+{
+#if (defined JAWBREAKER || defined HACKRF_ONE)
+	rffc5071_set_synth(mixer, cfg);
+#endif
+#ifdef RAD1O
+	(void)max2871_set_frequency(mixer, cfg->mhz);
+#endif
+}
+
+bool mixer_locked(mixer_driver_t* const mixer)
+{
+#if (defined JAWBREAKER || defined HACKRF_ONE)
+	return rffc5071_locked(mixer);
+#endif
+#ifdef RAD1O
+	/* max2871_set_frequency() waits for VCO selection to finish */
+	(void) mixer;
+	return true;
 #endif
 }
 
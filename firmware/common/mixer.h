@@ -26,19 +26,34 @@
 #if (defined JAWBREAKER || defined HACKRF_ONE)
 #include "rffc5071.h"
 typedef rffc5071_driver_t mixer_driver_t;
+typedef rffc5071_synth_config_t mixer_config_t;
 #endif
 
 #ifdef RAD1O
 #include "max2871.h"
 typedef max2871_driver_t mixer_driver_t;
+typedef struct {
+	uint16_t mhz;
+	uint64_t freq_hz;
+} mixer_config_t;
 #endif
 
 #include <stdint.h>
+#include <stdbool.h>
 extern void mixer_bus_setup(mixer_driver_t* const mixer);
 extern void mixer_setup(mixer_driver_t* const mixer);
 
-/* Set frequency (MHz). */
-extern uint64_t mixer_set_frequency(mixer_driver_t* const mixer, uint16_t mhz);
+/* Set frequency (Hz). Returns the frequency actually tuned. */
+extern uint64_t mixer_set_frequency(mixer_driver_t* const mixer, uint64_t hz);
+
+/* Compute settings for a frequency (Hz) ahead of time, then apply them.
+ * cfg->freq_hz is the frequency that will actually be tuned. */
+extern void mixer_compute_frequency(mixer_config_t* const cfg, uint64_t hz);
+extern void mixer_set_frequency_config(mixer_driver_t* const mixer,
+		const mixer_config_t* const cfg);
+
+/* Check PLL lock after a frequency change. */
+extern bool mixer_locked(mixer_driver_t* const mixer);
 
 /* Set up rx only, tx only, or full duplex. Chip should be disabled
  * before _tx, _rx, or _rxtx are called. */
@@ -115,8 +115,9 @@ uint8_t port_to_pins(uint8_t port) {
 	return 0xFF;
 }
 
-uint8_t operacake_set_ports(uint8_t address, uint8_t PA, uint8_t PB) {
-	uint8_t side, pa, pb, reg;
+/* Work out the output register value for a pair of ports. */
+static uint8_t operacake_ports_reg(uint8_t PA, uint8_t PB, uint8_t* const reg) {
+	uint8_t side, pa, pb;
 	/* Start with some error checking,
 	 * which should have been done either
 	 * on the host or elsewhere in firmware
@@ -139,9 +140,20 @@ uint8_t operacake_set_ports(uint8_t address, uint8_t PA, uint8_t PB) {
 	pa = port_to_pins(PA);
 	pb = port_to_pins(PB);
 		
-	reg = (OPERACAKE_GPIO_DISABLE | side
+	*reg = (OPERACAKE_GPIO_DISABLE | side
 					| pa | pb | OPERACAKE_EN_LEDS);
-	operacake_write_reg(oc_bus, address, OPERACAKE_REG_OUTPUT, reg);
+	return 0;
+}
+
+uint8_t operacake_set_ports(uint8_t address, uint8_t PA, uint8_t PB) {
+	uint8_t reg;
+	if(operacake_ports_reg(PA, PB, &reg)) {
+		return 1;
+	}
+	const uint8_t data[] = { OPERACAKE_REG_OUTPUT, reg };
+	if(i2c_bus_transfer(oc_bus, address, data, sizeof(data), NULL, 0) != I2C_STATUS_OK) {
+		return 1;
+	}
 	return 0;
 }
 
@@ -175,6 +187,21 @@ uint8_t operacake_add_range(uint16_t freq_min, uint16_t freq_max, uint8_t port)
 #define FREQ_ONE_MHZ (1000000ull)
 static uint8_t current_range = 0xFF;
 
+/*
+ * Range changes happen in the middle of a retune, so the port write is
+ * queued rather than waited for and goes out while the synthesizers
+ * settle. If it fails the range is forgotten and retried on the next
+ * call.
+ */
+static i2c_transaction_t range_transaction;
+static uint8_t range_data[2];
+
+static void operacake_range_done(i2c_transaction_t* const transaction) {
+	if(transaction->status != I2C_STATUS_OK) {
+		current_range = 0xFF;
+	}
+}
+
 uint8_t operacake_set_range(uint32_t freq_mhz) {
 	if(range_idx == 0) {
 		return 1;
@@ -190,7 +217,23 @@ uint8_t operacake_set_range(uint32_t freq_mhz) {
 		return 1;
 	}
 	
-	operacake_set_ports(operacake_boards[0], ranges[i].portA, ranges[i].portB);
+	uint8_t reg;
+	if(operacake_ports_reg(ranges[i].portA, ranges[i].portB, &reg)) {
+		return 1;
+	}
+	/* The buffer may still be on the bus from the last range change. */
+	if(range_transaction.status == I2C_STATUS_BUSY) {
+		i2c_bus_wait(oc_bus, &range_transaction);
+	}
+	range_data[0] = OPERACAKE_REG_OUTPUT;
+	range_data[1] = reg;
+	range_transaction.slave_address = operacake_boards[0];
+	range_transaction.tx = range_data;
+	range_transaction.tx_count = sizeof(range_data);
+	range_transaction.rx = NULL;
+	range_transaction.rx_count = 0;
+	range_transaction.callback = operacake_range_done;
 	current_range = i;
+	i2c_bus_submit(oc_bus, &range_transaction);
 	return 0;
 }
@@ -211,70 +211,160 @@ void rffc5071_enable(rffc5071_driver_t* const drv)  {
 #define REF_FREQ 40
 #define FREQ_ONE_MHZ (1000*1000)
 
-/* configure frequency synthesizer in integer mode (lo in MHz) */
-uint64_t rffc5071_config_synth_int(rffc5071_driver_t* const drv, uint16_t lo) {
+/* compute frequency synthesizer settings (lo in Hz) */
+void rffc5071_compute_synth(rffc5071_synth_config_t* const cfg, uint64_t lo_hz) {
 	uint8_t lodiv;
-	uint16_t fvco;
+	uint64_t fvco_hz;
 	uint8_t fbkdiv;
-	uint16_t n;
-	uint64_t tune_freq_hz;
-	uint16_t p1nmsb;
-	uint8_t p1nlsb;
 	
 	/* Calculate n_lo */
 	uint8_t n_lo = 0;
-	uint16_t x = LO_MAX / lo;
+	uint64_t x = ((uint64_t)LO_MAX * FREQ_ONE_MHZ) / lo_hz;
 	while ((x > 1) && (n_lo < 5)) {
 		n_lo++;
 		x >>= 1;
 	}
 
 	lodiv = 1 << n_lo;
-	fvco = lodiv * lo;
+	fvco_hz = lodiv * lo_hz;
 
 	/* higher divider and charge pump current required above
 	 * 3.2GHz. Programming guide says these values (fbkdiv, n,
 	 * maybe pump?) can be changed back after enable in order to
 	 * improve phase noise, since the VCO will already be stable
 	 * and will be unaffected. */
-	if (fvco > 3200) {
+	if (fvco_hz > (3200ULL * FREQ_ONE_MHZ)) {
 		fbkdiv = 4;
-		set_RFFC5071_PLLCPL(drv, 3);
+		cfg->pllcpl = 3;
 	} else {
 		fbkdiv = 2;
-		set_RFFC5071_PLLCPL(drv, 2);
+		cfg->pllcpl = 2;
 	}
 
-	uint64_t tmp_n = ((uint64_t)fvco << 29ULL) / (fbkdiv*REF_FREQ) ;
-	n = tmp_n >> 29ULL;
+	/* N with the 24 fractional bits held in P2NMSB and P2NLSB, rounded
+	 * to the nearest step. */
+	const uint64_t pfd_hz = (uint64_t)fbkdiv * REF_FREQ * FREQ_ONE_MHZ;
+	const uint64_t tmp_n = ((fvco_hz << 24ULL) + (pfd_hz / 2)) / pfd_hz;
 
-	p1nmsb = (tmp_n >> 13ULL) & 0xffff;
-	p1nlsb = (tmp_n >> 5ULL) & 0xff;
-	
-	tune_freq_hz = (REF_FREQ * (tmp_n >> 5ULL) * fbkdiv * FREQ_ONE_MHZ)
-			/ (lodiv * (1 << 24ULL));
+	cfg->n_lo = n_lo;
+	cfg->n = tmp_n >> 24ULL;
+	cfg->presc = fbkdiv >> 1;
+	cfg->nmsb = (tmp_n >> 8ULL) & 0xffff;
+	cfg->nlsb = tmp_n & 0xff;
+
+	/* The LO actually tuned, rounded to the nearest Hz. */
+	const uint64_t lo_den = (uint64_t)lodiv << 24ULL;
+	cfg->freq_hz = ((pfd_hz * tmp_n) + (lo_den / 2)) / lo_den;
+}
+
+/* compute frequency synthesizer settings in integer mode (lo in MHz) */
+void rffc5071_compute_synth_int(rffc5071_synth_config_t* const cfg, uint16_t lo) {
+	rffc5071_compute_synth(cfg, (uint64_t)lo * FREQ_ONE_MHZ);
+}
+
+/* Registers written by rffc5071_config_synth: PLLCPL is in register 0,
+ * the path 2 dividers in P2_FREQ1..3. */
+#define RFFC5071_SYNTH_REG_COUNT 4
+static const uint8_t rffc5071_synth_regs[RFFC5071_SYNTH_REG_COUNT] = { 0, 15, 16, 17 };
+#define RFFC5071_ENBL_REG 21
+
+/* write precomputed synthesizer settings to the chip */
+static void rffc5071_config_synth(rffc5071_driver_t* const drv,
+		const rffc5071_synth_config_t* const cfg) {
+	const uint32_t dirty = drv->regs_dirty;
+	uint16_t before[RFFC5071_SYNTH_REG_COUNT];
+	size_t i;
+
+	for(i=0; i<RFFC5071_SYNTH_REG_COUNT; i++) {
+		before[i] = drv->regs[rffc5071_synth_regs[i]];
+	}
+
+	set_RFFC5071_PLLCPL(drv, cfg->pllcpl);
 
 	/* Path 2 */
-	set_RFFC5071_P2LODIV(drv, n_lo);
-	set_RFFC5071_P2N(drv, n);
-	set_RFFC5071_P2PRESC(drv, fbkdiv >> 1);
-	set_RFFC5071_P2NMSB(drv, p1nmsb);
-	set_RFFC5071_P2NLSB(drv, p1nlsb);
+	set_RFFC5071_P2LODIV(drv, cfg->n_lo);
+	set_RFFC5071_P2N(drv, cfg->n);
+	set_RFFC5071_P2PRESC(drv, cfg->presc);
+	set_RFFC5071_P2NMSB(drv, cfg->nmsb);
+	set_RFFC5071_P2NLSB(drv, cfg->nlsb);
+
+	/* Between hops usually only some of these change, the rest need no
+	 * bus transaction. */
+	for(i=0; i<RFFC5071_SYNTH_REG_COUNT; i++) {
+		const uint8_t r = rffc5071_synth_regs[i];
+		if( (drv->regs[r] == before[i]) && !((dirty >> r) & 0x1) ) {
+			RFFC5071_REG_SET_CLEAN(drv, r);
+		}
+	}
 
 	rffc5071_regs_commit(drv);
+}
+
+/* True if the chip is enabled and already running these settings. */
+static bool rffc5071_synth_is_current(rffc5071_driver_t* const drv,
+		const rffc5071_synth_config_t* const cfg) {
+	size_t i;
+
+	for(i=0; i<RFFC5071_SYNTH_REG_COUNT; i++) {
+		if( (drv->regs_dirty >> rffc5071_synth_regs[i]) & 0x1 ) {
+			return false;
+		}
+	}
+
+	return (get_RFFC5071_ENBL(drv) == 1)
+		&& !((drv->regs_dirty >> RFFC5071_ENBL_REG) & 0x1)
+		&& (get_RFFC5071_PLLCPL(drv) == cfg->pllcpl)
+		&& (get_RFFC5071_P2LODIV(drv) == cfg->n_lo)
+		&& (get_RFFC5071_P2N(drv) == cfg->n)
+		&& (get_RFFC5071_P2PRESC(drv) == cfg->presc)
+		&& (get_RFFC5071_P2NMSB(drv) == cfg->nmsb)
+		&& (get_RFFC5071_P2NLSB(drv) == cfg->nlsb);
+}
+
+/* configure frequency synthesizer in integer mode (lo in MHz) */
+uint64_t rffc5071_config_synth_int(rffc5071_driver_t* const drv, uint16_t lo) {
+	rffc5071_synth_config_t cfg;
 
-	return tune_freq_hz;
+	rffc5071_compute_synth_int(&cfg, lo);
+	rffc5071_config_synth(drv, &cfg);
+
+	return cfg.freq_hz;
 }
 
-/* !!!!!!!!!!! hz is currently ignored !!!!!!!!!!! */
 uint64_t rffc5071_set_frequency(rffc5071_driver_t* const drv, uint16_t mhz) {
-	uint32_t tune_freq;
+	return rffc5071_set_frequency_hz(drv, (uint64_t)mhz * FREQ_ONE_MHZ);
+}
+
+uint64_t rffc5071_set_frequency_hz(rffc5071_driver_t* const drv, uint64_t hz) {
+	rffc5071_synth_config_t cfg;
+
+	rffc5071_compute_synth(&cfg, hz);
+	rffc5071_set_synth(drv, &cfg);
+
+	return cfg.freq_hz;
+}
+
+/* Toggling ENBL around the divider writes restarts VCO calibration. A hop
+ * that lands on the settings already running is skipped entirely. */
+void rffc5071_set_synth(rffc5071_driver_t* const drv,
+		const rffc5071_synth_config_t* const cfg) {
+	if( rffc5071_synth_is_current(drv, cfg) ) {
+		return;
+	}
 
 	rffc5071_disable(drv);
-	tune_freq = rffc5071_config_synth_int(drv, mhz);
+	rffc5071_config_synth(drv, cfg);
 	rffc5071_enable(drv);
+}
 
-	return tune_freq;
+/* Readback register 1 (READSEL = 1, the reset default) has the PLL lock
+ * status in its MSB. */
+bool rffc5071_locked(rffc5071_driver_t* const drv) {
+	if (get_RFFC5071_READSEL(drv) != 1) {
+		set_RFFC5071_READSEL(drv, 1);
+		rffc5071_regs_commit(drv);
+	}
+	return (rffc5071_reg_read(drv, RFFC5071_READBACK_REG) >> 15) & 0x1;
 }
 
 void rffc5071_set_gpo(rffc5071_driver_t* const drv, uint8_t gpo)
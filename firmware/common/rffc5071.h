@@ -24,6 +24,7 @@
 #define __RFFC5071_H
 
 #include <stdint.h>
+#include <stdbool.h>
 
 #include "spi_bus.h"
 #include "gpio.h"
@@ -38,6 +39,18 @@ typedef struct {
 	uint32_t regs_dirty;
 } rffc5071_driver_t;
 
+/* Synthesizer settings for one frequency, computed ahead of time so that
+ * retuning only has to write registers. */
+typedef struct {
+	uint8_t n_lo;
+	uint16_t n;
+	uint8_t presc;
+	uint16_t nmsb;
+	uint8_t nlsb;
+	uint8_t pllcpl;
+	uint64_t freq_hz;
+} rffc5071_synth_config_t;
+
 /* Initialize chip. Call _setup() externally, as it calls _init(). */
 extern void rffc5071_init(rffc5071_driver_t* const drv);
 extern void rffc5071_setup(rffc5071_driver_t* const drv);
@@ -58,6 +71,20 @@ extern void rffc5071_regs_commit(rffc5071_driver_t* const drv);
 /* Set frequency (MHz). */
 extern uint64_t rffc5071_set_frequency(rffc5071_driver_t* const drv, uint16_t mhz);
 
+/* Set frequency (Hz) using the full fractional-N divider. Returns the
+ * frequency actually tuned, to the nearest Hz. */
+extern uint64_t rffc5071_set_frequency_hz(rffc5071_driver_t* const drv, uint64_t hz);
+
+/* Compute synthesizer settings (MHz, or Hz for _compute_synth) without
+ * accessing the chip, and later set the frequency from them. */
+extern void rffc5071_compute_synth_int(rffc5071_synth_config_t* const cfg, uint16_t lo);
+extern void rffc5071_compute_synth(rffc5071_synth_config_t* const cfg, uint64_t lo_hz);
+extern void rffc5071_set_synth(rffc5071_driver_t* const drv,
+		const rffc5071_synth_config_t* const cfg);
+
+/* Read PLL lock status. */
+extern bool rffc5071_locked(rffc5071_driver_t* const drv);
+
 /* Set up rx only, tx only, or full duplex. Chip should be disabled
  * before _tx, _rx, or _rxtx are called. */
 extern void rffc5071_tx(rffc5071_driver_t* const drv);
@@ -22,6 +22,7 @@
 
 #include <libopencm3/lpc43xx/scu.h>
 #include "hackrf_core.h"
+#include "gpio_lpc.h"
 
 #include "rffc5071_spi.h"
 
@@ -92,9 +93,15 @@ void rffc5071_spi_stop(spi_bus_t* const bus) {
 	(void)bus;
 }
 
-static void rffc5071_spi_serial_delay(spi_bus_t* const bus) {
+/* Pads each half of the serial clock. Without the function call overhead
+ * of the gpio_* helpers around it, this keeps SCLK at roughly 10 MHz.
+ */
+static inline void rffc5071_spi_serial_delay(spi_bus_t* const bus) {
 	(void)bus;
-	__asm__("nop");
+	__asm__ volatile(
+		"nop\n\t" "nop\n\t" "nop\n\t" "nop\n\t"
+		"nop\n\t" "nop\n\t" "nop\n\t" "nop\n\t"
+	);
 }
 
 static void rffc5071_spi_sck(spi_bus_t* const bus) {
@@ -107,19 +114,28 @@ static void rffc5071_spi_sck(spi_bus_t* const bus) {
 	gpio_clear(config->gpio_clock);
 }
 
-static uint32_t rffc5071_spi_exchange_bit(spi_bus_t* const bus, const uint32_t bit) {
-	rffc5071_spi_data_out(bus, bit);
-	rffc5071_spi_sck(bus);
-	return rffc5071_spi_data_in(bus) ? 1 : 0;
-}
-
+/* Shifts a word MSB first. The clock and data pins are driven through
+ * their port registers directly, so the loop only costs a few cycles
+ * per bit on top of the clock padding.
+ */
 static uint32_t rffc5071_spi_exchange_word(spi_bus_t* const bus, const uint32_t data, const size_t count) {
+	const rffc5071_spi_config_t* const config = bus->config;
+	volatile uint32_t* const clock_set = &config->gpio_clock->port->set;
+	volatile uint32_t* const clock_clr = &config->gpio_clock->port->clr;
+	const uint32_t clock_mask = config->gpio_clock->mask;
+	volatile uint32_t* const data_w = config->gpio_data->gpio_w;
+
 	size_t bits = count;
 	const uint32_t msb = 1UL << (count - 1);
 	uint32_t t = data;
 
 	while (bits--) {
-		t = (t << 1) | rffc5071_spi_exchange_bit(bus, t & msb);
+		*data_w = (t & msb) ? 1 : 0;
+		rffc5071_spi_serial_delay(bus);
+		*clock_set = clock_mask;
+		rffc5071_spi_serial_delay(bus);
+		*clock_clr = clock_mask;
+		t = (t << 1) | ((*data_w) ? 1 : 0);
 	}
 
 	return t & ((1UL << count) - 1);
@@ -0,0 +1,130 @@
+/*
+ * Copyright 2017 Great Scott Gadgets
+ *
+ * This file is part of HackRF.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+
+
+#include <sgpio_dma.h>
+
+#include <libopencm3/lpc43xx/creg.h>
+#include <libopencm3/lpc43xx/gpdma.h>
+#include <libopencm3/lpc43xx/sgpio.h>
+
+#include <gpdma.h>
+
+/* SGPIO14 (driven by the single-slice mode DMA request slice) is routed
+ * to GPDMA peripheral request line 0 by DMAMUX setting 0x2.
+ */
+#define SGPIO_DMA_PERIPHERAL 0
+#define SGPIO_DMA_CHANNEL 0
+
+/* GPDMA AHB master 0 can reach the SGPIO registers, master 1 is used for
+ * the sample buffer in RAM so the two sides of a transfer don't contend.
+ */
+#define SGPIO_DMA_PERIPHERAL_MASTER 0
+#define SGPIO_DMA_MEMORY_MASTER 1
+
+void sgpio_dma_configure_lli(
+	gpdma_lli_t* const lli,
+	const size_t lli_count,
+	const bool direction_transmit,
+	void* const buffer,
+	const size_t transfer_bytes
+) {
+	const size_t bytes_per_word = 4;
+	const size_t transfer_words = (transfer_bytes + bytes_per_word - 1) / bytes_per_word;
+
+	gpdma_lli_create_loop(lli, lli_count);
+
+	for(size_t i=0; i<lli_count; i++) {
+		void* const peripheral_address = (void*)&SGPIO_REG_SS(SGPIO_SLICE_A);
+		void* const memory_address = (uint8_t*)buffer + (i * transfer_bytes);
+
+		const uint_fast8_t source_master = direction_transmit ? SGPIO_DMA_MEMORY_MASTER : SGPIO_DMA_PERIPHERAL_MASTER;
+		const uint_fast8_t destination_master = direction_transmit ? SGPIO_DMA_PERIPHERAL_MASTER : SGPIO_DMA_MEMORY_MASTER;
+
+		lli[i].csrcaddr = direction_transmit ? memory_address : peripheral_address;
+		lli[i].cdestaddr = direction_transmit ? peripheral_address : memory_address;
+		lli[i].clli = (lli[i].clli & ~GPDMA_CLLI_LM_MASK) | GPDMA_CLLI_LM(SGPIO_DMA_MEMORY_MASTER);
+		lli[i].ccontrol =
+			  GPDMA_CCONTROL_TRANSFERSIZE(transfer_words)
+			| GPDMA_CCONTROL_SBSIZE(0)
+			| GPDMA_CCONTROL_DBSIZE(0)
+			| GPDMA_CCONTROL_SWIDTH(2)
+			| GPDMA_CCONTROL_DWIDTH(2)
+			| GPDMA_CCONTROL_S(source_master)
+			| GPDMA_CCONTROL_D(destination_master)
+			| GPDMA_CCONTROL_SI(direction_transmit ? 1 : 0)
+			| GPDMA_CCONTROL_DI(direction_transmit ? 0 : 1)
+			| GPDMA_CCONTROL_PROT1(0)
+			| GPDMA_CCONTROL_PROT2(0)
+			| GPDMA_CCONTROL_PROT3(0)
+			| GPDMA_CCONTROL_I(0)
+			;
+	}
+}
+
+static void sgpio_dma_enable(const gpdma_lli_t* const start_lli, const bool direction_transmit) {
+	gpdma_channel_disable(SGPIO_DMA_CHANNEL);
+	gpdma_channel_interrupt_tc_clear(SGPIO_DMA_CHANNEL);
+	gpdma_channel_interrupt_error_clear(SGPIO_DMA_CHANNEL);
+
+	GPDMA_CSRCADDR(SGPIO_DMA_CHANNEL) = (uint32_t)start_lli->csrcaddr;
+	GPDMA_CDESTADDR(SGPIO_DMA_CHANNEL) = (uint32_t)start_lli->cdestaddr;
+	GPDMA_CLLI(SGPIO_DMA_CHANNEL) = start_lli->clli;
+	GPDMA_CCONTROL(SGPIO_DMA_CHANNEL) = start_lli->ccontrol;
+
+	/* 1: Memory -> Peripheral, 2: Peripheral -> Memory, both DMA-controlled */
+	const uint_fast8_t flowcntrl = direction_transmit ? 1 : 2;
+
+	GPDMA_CCONFIG(SGPIO_DMA_CHANNEL) =
+		  GPDMA_CCONFIG_E(0)
+		| GPDMA_CCONFIG_SRCPERIPHERAL(direction_transmit ? 0 : SGPIO_DMA_PERIPHERAL)
+		| GPDMA_CCONFIG_DESTPERIPHERAL(direction_transmit ? SGPIO_DMA_PERIPHERAL : 0)
+		| GPDMA_CCONFIG_FLOWCNTRL(flowcntrl)
+		| GPDMA_CCONFIG_IE(1)
+		| GPDMA_CCONFIG_ITC(1)
+		| GPDMA_CCONFIG_L(0)
+		| GPDMA_CCONFIG_H(0)
+		;
+
+	gpdma_channel_enable(SGPIO_DMA_CHANNEL);
+}
+
+void sgpio_dma_init() {
+	CREG_DMAMUX = (CREG_DMAMUX & ~(0x3 << (SGPIO_DMA_PERIPHERAL * 2)))
+		| (0x2 << (SGPIO_DMA_PERIPHERAL * 2));
+	gpdma_controller_enable();
+}
+
+void sgpio_dma_rx_start(const gpdma_lli_t* const start_lli) {
+	sgpio_dma_enable(start_lli, false);
+}
+
+void sgpio_dma_tx_start(const gpdma_lli_t* const start_lli) {
+	sgpio_dma_enable(start_lli, true);
+}
+
+void sgpio_dma_irq_tc_acknowledge() {
+	gpdma_channel_interrupt_tc_clear(SGPIO_DMA_CHANNEL);
+}
+
+void sgpio_dma_stop() {
+	gpdma_channel_disable(SGPIO_DMA_CHANNEL);
+}
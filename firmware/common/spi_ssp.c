@@ -57,47 +57,79 @@ void spi_ssp_stop(spi_bus_t* const bus) {
 	SSP_CR1(bus->obj) = 0;
 }
 
-static void spi_ssp_wait_for_tx_fifo_not_full(spi_bus_t* const bus) {
-	while( (SSP_SR(bus->obj) & SSP_SR_TNF) == 0 );
-}
-
-static void spi_ssp_wait_for_rx_fifo_not_empty(spi_bus_t* const bus) {
-	while( (SSP_SR(bus->obj) & SSP_SR_RNE) == 0 );
-}
+/* Words the SSP can hold between the TX and RX FIFOs. With no more than
+ * this many words written and not yet read back, the RX FIFO can't
+ * overflow.
+ */
+#define SPI_SSP_FIFO_DEPTH 8
 
 static void spi_ssp_wait_for_not_busy(spi_bus_t* const bus) {
 	while( SSP_SR(bus->obj) & SSP_SR_BSY );
 }
 
-static uint32_t spi_ssp_transfer_word(spi_bus_t* const bus, const uint32_t data) {
-	spi_ssp_wait_for_tx_fifo_not_full(bus);
-	SSP_DR(bus->obj) = data;
-	spi_ssp_wait_for_not_busy(bus);
-	spi_ssp_wait_for_rx_fifo_not_empty(bus);
-	return SSP_DR(bus->obj);
+/* Walks the words of a gather list. */
+typedef struct {
+	size_t transfer;
+	size_t word;
+} spi_ssp_cursor_t;
+
+static void spi_ssp_cursor_skip_empty(spi_ssp_cursor_t* const cursor,
+		const spi_transfer_t* const transfers, const size_t count) {
+	while( (cursor->transfer < count)
+	    && (cursor->word >= transfers[cursor->transfer].count) ) {
+		cursor->transfer++;
+		cursor->word = 0;
+	}
+}
+
+static void spi_ssp_cursor_next(spi_ssp_cursor_t* const cursor,
+		const spi_transfer_t* const transfers, const size_t count) {
+	cursor->word++;
+	spi_ssp_cursor_skip_empty(cursor, transfers, count);
 }
 
+/* Keeps the TX FIFO topped up and empties the RX FIFO as words arrive,
+ * rather than waiting for each word to be clocked out before the next.
+ * Received words overwrite the ones sent, which have already gone.
+ */
 void spi_ssp_transfer_gather(spi_bus_t* const bus, const spi_transfer_t* const transfers, const size_t count) {
 	const ssp_config_t* const config = bus->config;
 
 	const bool word_size_u16 = (SSP_CR0(bus->obj) & 0xf) > SSP_DATA_8BITS;
 
-	gpio_clear(config->gpio_select);
-	for(size_t i=0; i<count; i++) {
-		const size_t data_count = transfers[i].count;
+	spi_ssp_cursor_t tx = { 0, 0 };
+	spi_ssp_cursor_t rx = { 0, 0 };
+	size_t in_flight = 0;
 
-		if( word_size_u16 ) {
-			uint16_t* const data = transfers[i].data;
-			for(size_t j=0; j<data_count; j++) {
-				data[j] = spi_ssp_transfer_word(bus, data[j]);
+	spi_ssp_cursor_skip_empty(&tx, transfers, count);
+	spi_ssp_cursor_skip_empty(&rx, transfers, count);
+
+	gpio_clear(config->gpio_select);
+	while( rx.transfer < count ) {
+		while( (tx.transfer < count)
+		    && (in_flight < SPI_SSP_FIFO_DEPTH)
+		    && (SSP_SR(bus->obj) & SSP_SR_TNF) ) {
+			if( word_size_u16 ) {
+				SSP_DR(bus->obj) = ((uint16_t*)transfers[tx.transfer].data)[tx.word];
+			} else {
+				SSP_DR(bus->obj) = ((uint8_t*)transfers[tx.transfer].data)[tx.word];
 			}
-		} else {
-			uint8_t* const data = transfers[i].data;
-			for(size_t j=0; j<data_count; j++) {
-				data[j] = spi_ssp_transfer_word(bus, data[j]);
+			in_flight++;
+			spi_ssp_cursor_next(&tx, transfers, count);
+		}
+
+		if( SSP_SR(bus->obj) & SSP_SR_RNE ) {
+			const uint32_t data = SSP_DR(bus->obj);
+			if( word_size_u16 ) {
+				((uint16_t*)transfers[rx.transfer].data)[rx.word] = data;
+			} else {
+				((uint8_t*)transfers[rx.transfer].data)[rx.word] = data;
 			}
+			in_flight--;
+			spi_ssp_cursor_next(&rx, transfers, count);
 		}
 	}
+	spi_ssp_wait_for_not_busy(bus);
 	gpio_set(config->gpio_select);
 }
 
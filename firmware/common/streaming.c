@@ -25,6 +25,8 @@
 #include <libopencm3/lpc43xx/m4/nvic.h>
 #include <libopencm3/lpc43xx/sgpio.h>
 
+#include <sgpio_dma.h>
+
 void baseband_streaming_enable(sgpio_config_t* const sgpio_config) {
 	nvic_set_priority(NVIC_SGPIO_IRQ, 0);
 	nvic_enable_irq(NVIC_SGPIO_IRQ);
@@ -38,3 +40,17 @@ void baseband_streaming_disable(sgpio_config_t* const sgpio_config) {
 
 	nvic_disable_irq(NVIC_SGPIO_IRQ);
 }
+
+void baseband_streaming_dma_enable(sgpio_config_t* const sgpio_config) {
+	nvic_set_priority(NVIC_DMA_IRQ, 0);
+	nvic_enable_irq(NVIC_DMA_IRQ);
+
+	sgpio_cpld_stream_enable(sgpio_config);
+}
+
+void baseband_streaming_dma_disable(sgpio_config_t* const sgpio_config) {
+	sgpio_cpld_stream_disable(sgpio_config);
+
+	nvic_disable_irq(NVIC_DMA_IRQ);
+	sgpio_dma_stop();
+}
@@ -27,5 +27,7 @@
 
 void baseband_streaming_enable(sgpio_config_t* const sgpio_config);
 void baseband_streaming_disable(sgpio_config_t* const sgpio_config);
+void baseband_streaming_dma_enable(sgpio_config_t* const sgpio_config);
+void baseband_streaming_dma_disable(sgpio_config_t* const sgpio_config);
 
 #endif/*__STREAMING_H__*/
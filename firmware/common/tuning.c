@@ -30,6 +30,9 @@
 #include <sgpio.h>
 #include <operacake.h>
 
+#include <libopencm3/cm3/cortex.h>
+#include <libopencm3/cm3/dwt.h>
+
 #define FREQ_ONE_MHZ     (1000*1000)
 
 #define MIN_LP_FREQ_MHZ (0)
@@ -46,49 +49,93 @@
 #define MIN_LO_FREQ_HZ (84375000)
 #define MAX_LO_FREQ_HZ (5400000000ULL)
 
-static uint32_t max2837_freq_nominal_hz=2560000000;
+/* The planned IF is kept on this grid, so that neighbouring frequencies
+ * share an IF and a hop between them only retunes the mixer. */
+#define IF_PLAN_STEP_HZ (FREQ_ONE_MHZ)
+
+/* If the mixer lands this close to the planned LO, the planned IF is
+ * used as is rather than moving the MAX2837 to absorb the difference. */
+#define MIXER_TOLERANCE_HZ (10)
+
+/* Direct-mapped cache of computed tuning settings, keyed by frequency. */
+#define TUNING_CACHE_BITS (6)
+#define TUNING_CACHE_SIZE (1 << TUNING_CACHE_BITS)
 
 uint64_t freq_cache = 100000000;
+
+/* Whether the most recently applied frequency used the mixer. */
+static bool mixer_in_use = false;
+
+static tuning_config_t tuning_cache[TUNING_CACHE_SIZE];
+static bool tuning_cache_valid[TUNING_CACHE_SIZE];
+
+/* Hops up to this size keep the mixer where it is and move only the
+ * MAX2837, as long as the IF stays this close to its planned value. */
+#define FAST_HOP_MAX_HZ (5 * FREQ_ONE_MHZ)
+
+/* State last written by tuning_set_freq_config, for the retune planner
+ * to diff against. */
+static tuning_config_t applied;
+static bool applied_valid = false;
+
+tuning_stats_t tuning_stats;
+
+static uint64_t distance(const uint64_t a, const uint64_t b)
+{
+	return (a > b) ? (a - b) : (b - a);
+}
+
+/* Settle the MAX2837 on the planned IF unless the mixer missed the
+ * planned LO by more than MIXER_TOLERANCE_HZ (e.g. on a coarse mixer),
+ * in which case the IF takes up the difference. */
+static void tuning_compute_if(tuning_config_t* const cfg, const uint64_t freq,
+		const uint64_t lo_planned_hz, const uint32_t if_planned_hz)
+{
+	if (distance(cfg->mixer.freq_hz, lo_planned_hz) <= MIXER_TOLERANCE_HZ) {
+		max2837_compute_frequency(&cfg->max2837, if_planned_hz);
+	} else {
+		max2837_compute_frequency(&cfg->max2837, distance(cfg->mixer.freq_hz, freq));
+	}
+}
+
 /*
- * Set freq/tuning between 0MHz to 7250 MHz (less than 16bits really used)
- * hz between 0 to 999999 Hz (not checked)
+ * Work out the RF path, mixer and MAX2837 settings for freq without
+ * touching any hardware, so that they can be prepared ahead of a retune.
+ * Tuning between 0MHz to 7250 MHz (less than 16bits really used)
  * return false on error or true if success.
  */
-bool set_freq(const uint64_t freq)
+bool tuning_compute_freq(tuning_config_t* const cfg, const uint64_t freq)
 {
-	bool success;
-	uint32_t mixer_freq_mhz;
-	uint32_t MAX2837_freq_hz;
-	uint64_t real_mixer_freq_hz;
+	uint32_t max2837_freq_nominal_hz;
+	uint64_t mixer_freq_hz;
 
 	const uint32_t freq_mhz = freq / 1000000;
 	const uint32_t freq_hz = freq % 1000000;
 
-	success = true;
-
-	const max2837_mode_t prior_max2837_mode = max2837_mode(&max2837);
-	max2837_set_mode(&max2837, MAX2837_MODE_STANDBY);
+	cfg->freq = freq;
 	if(freq_mhz < MAX_LP_FREQ_MHZ)
 	{
-		rf_path_set_filter(&rf_path, RF_PATH_FILTER_LOW_PASS);
+		cfg->filter = RF_PATH_FILTER_LOW_PASS;
 #ifdef RAD1O
 		max2837_freq_nominal_hz = 2300000000;
 #else
 		/* IF is graduated from 2650 MHz to 2343 MHz */
 		max2837_freq_nominal_hz = 2650000000 - (freq / 7);
 #endif
-		mixer_freq_mhz = (max2837_freq_nominal_hz / FREQ_ONE_MHZ) + freq_mhz;
-		/* Set Freq and read real freq */
-		real_mixer_freq_hz = mixer_set_frequency(&mixer, mixer_freq_mhz);
-		max2837_set_frequency(&max2837, real_mixer_freq_hz - freq);
-		sgpio_cpld_stream_rx_set_q_invert(&sgpio_config, 1);
+		max2837_freq_nominal_hz -= max2837_freq_nominal_hz % IF_PLAN_STEP_HZ;
+		mixer_freq_hz = max2837_freq_nominal_hz + freq;
+		/* Compute real mixer freq */
+		mixer_compute_frequency(&cfg->mixer, mixer_freq_hz);
+		tuning_compute_if(cfg, freq, mixer_freq_hz, max2837_freq_nominal_hz);
+		cfg->use_mixer = true;
+		cfg->q_invert = 1;
 	}else if( (freq_mhz >= MIN_BYPASS_FREQ_MHZ) && (freq_mhz < MAX_BYPASS_FREQ_MHZ) )
 	{
-		rf_path_set_filter(&rf_path, RF_PATH_FILTER_BYPASS);
-		MAX2837_freq_hz = (freq_mhz * FREQ_ONE_MHZ) + freq_hz;
-		/* mixer_freq_mhz <= not used in Bypass mode */
-		max2837_set_frequency(&max2837, MAX2837_freq_hz);
-		sgpio_cpld_stream_rx_set_q_invert(&sgpio_config, 0);
+		cfg->filter = RF_PATH_FILTER_BYPASS;
+		/* mixer is not used in Bypass mode */
+		max2837_compute_frequency(&cfg->max2837, (freq_mhz * FREQ_ONE_MHZ) + freq_hz);
+		cfg->use_mixer = false;
+		cfg->q_invert = 0;
 	}else if(  (freq_mhz >= MIN_HP_FREQ_MHZ) && (freq_mhz <= MAX_HP_FREQ_MHZ) )
 	{
 		if (freq_mhz < MID1_HP_FREQ_MHZ) {
@@ -101,24 +148,184 @@ bool set_freq(const uint64_t freq)
 			/* IF is graduated from 2500 MHz to 2738 MHz */
 			max2837_freq_nominal_hz = 2500000000 + ((freq - 5100000000) / 9);
 		}
-		rf_path_set_filter(&rf_path, RF_PATH_FILTER_HIGH_PASS);
-		mixer_freq_mhz = freq_mhz - (max2837_freq_nominal_hz / FREQ_ONE_MHZ);
-		/* Set Freq and read real freq */
-		real_mixer_freq_hz = mixer_set_frequency(&mixer, mixer_freq_mhz);
-		max2837_set_frequency(&max2837, freq - real_mixer_freq_hz);
-		sgpio_cpld_stream_rx_set_q_invert(&sgpio_config, 0);
+		max2837_freq_nominal_hz -= max2837_freq_nominal_hz % IF_PLAN_STEP_HZ;
+		cfg->filter = RF_PATH_FILTER_HIGH_PASS;
+		mixer_freq_hz = freq - max2837_freq_nominal_hz;
+		/* Compute real mixer freq */
+		mixer_compute_frequency(&cfg->mixer, mixer_freq_hz);
+		tuning_compute_if(cfg, freq, mixer_freq_hz, max2837_freq_nominal_hz);
+		cfg->use_mixer = true;
+		cfg->q_invert = 0;
 	}else
 	{
 		/* Error freq_mhz too high */
-		success = false;
+		return false;
+	}
+	return true;
+}
+
+static uint32_t tuning_cache_index(const uint64_t freq)
+{
+	/* Multiplicative hash; sweep frequencies tend to share low bits. */
+	const uint32_t h = (uint32_t)freq ^ (uint32_t)(freq >> 32);
+	return (h * 2654435761U) >> (32 - TUNING_CACHE_BITS);
+}
+
+/*
+ * Same as tuning_compute_freq(), but reuses settings computed earlier for
+ * the same frequency. The settings only depend on freq, so cached entries
+ * never go stale. Sweeps revisit the same frequencies on every pass, so
+ * after the first pass a retune costs only the register writes.
+ *
+ * Called from both the main loop and the USB interrupt, so entries are
+ * only copied in or out with interrupts masked. The computation itself
+ * runs unmasked; if two callers miss on the same entry, both store the
+ * same settings.
+ */
+bool tuning_compute_freq_cached(tuning_config_t* const cfg, const uint64_t freq)
+{
+	const uint32_t i = tuning_cache_index(freq);
+	bool hit;
+
+	uint32_t primask = cm_mask_interrupts(1);
+	hit = tuning_cache_valid[i] && (tuning_cache[i].freq == freq);
+	if (hit) {
+		*cfg = tuning_cache[i];
+	}
+	cm_mask_interrupts(primask);
+	if (hit) {
+		return true;
+	}
+
+	if (!tuning_compute_freq(cfg, freq)) {
+		return false;
+	}
+
+	primask = cm_mask_interrupts(1);
+	tuning_cache[i] = *cfg;
+	tuning_cache_valid[i] = true;
+	cm_mask_interrupts(primask);
+	return true;
+}
+
+static bool max2837_config_equal(const max2837_freq_config_t* const a,
+		const max2837_freq_config_t* const b)
+{
+	return (a->band == b->band)
+		&& (a->lna_band == b->lna_band)
+		&& (a->div_int == b->div_int)
+		&& (a->div_frac == b->div_frac);
+}
+
+/*
+ * A small hop within the same filter path can be made by leaving the mixer
+ * alone and moving the IF by the size of the hop, which costs only a
+ * MAX2837 divider write. Returns false if that would move the IF too far
+ * from the one planned for the target.
+ */
+static bool tuning_plan_fast_hop(tuning_config_t* const plan)
+{
+	if (!applied_valid || !applied.use_mixer || !plan->use_mixer
+			|| (applied.filter != plan->filter)
+			|| (distance(applied.freq, plan->freq) > FAST_HOP_MAX_HZ)) {
+		return false;
+	}
+
+	const uint64_t if_planned_hz = distance(plan->mixer.freq_hz, plan->freq);
+	const uint64_t if_hz = distance(applied.mixer.freq_hz, plan->freq);
+	if (distance(if_hz, if_planned_hz) > FAST_HOP_MAX_HZ) {
+		return false;
+	}
+
+	plan->mixer = applied.mixer;
+	max2837_compute_frequency(&plan->max2837, if_hz);
+	return true;
+}
+
+/*
+ * Apply settings from tuning_compute_freq(). The target is diffed against
+ * what was last applied and only the parts that differ are written: the
+ * filter path, the mixer LO, the MAX2837 synthesizer and Q inversion.
+ * Operacake ports are only switched by operacake_set_range() when the
+ * range changes, and that I2C write is queued so it overlaps settling.
+ */
+void tuning_set_freq_config(const tuning_config_t* const cfg)
+{
+	const uint32_t start = DWT_CYCCNT;
+	tuning_config_t plan = *cfg;
+	const bool fast = tuning_plan_fast_hop(&plan);
+
+	const bool filter_changed = !applied_valid
+		|| (applied.filter != plan.filter);
+	const bool mixer_changed = plan.use_mixer
+		&& (filter_changed || !applied.use_mixer
+			|| (applied.mixer.freq_hz != plan.mixer.freq_hz));
+	const bool max2837_changed = !applied_valid
+		|| !max2837_config_equal(&applied.max2837, &plan.max2837);
+
+	const max2837_mode_t prior_max2837_mode = max2837_mode(&max2837);
+	if (max2837_changed) {
+		max2837_set_mode(&max2837, MAX2837_MODE_STANDBY);
+	}
+	if (filter_changed) {
+		rf_path_set_filter(&rf_path, plan.filter);
+		tuning_stats.filter_changes++;
+	}
+	if (mixer_changed) {
+		mixer_set_frequency_config(&mixer, &plan.mixer);
+		tuning_stats.mixer_changes++;
+	}
+	if (max2837_changed) {
+		max2837_set_frequency_config(&max2837, &plan.max2837);
+		tuning_stats.max2837_changes++;
 	}
-	max2837_set_mode(&max2837, prior_max2837_mode);
-	if( success ) {
-		freq_cache = freq;
-		hackrf_ui_setFrequency(freq);
-		operacake_set_range(freq_mhz);
+	if (!applied_valid || (applied.q_invert != plan.q_invert)) {
+		sgpio_cpld_stream_rx_set_q_invert(&sgpio_config, plan.q_invert);
 	}
-	return success;
+	if (max2837_changed) {
+		max2837_set_mode(&max2837, prior_max2837_mode);
+	}
+	mixer_in_use = plan.use_mixer;
+	applied = plan;
+	applied_valid = true;
+
+	freq_cache = cfg->freq;
+	hackrf_ui_setFrequency(cfg->freq);
+	operacake_set_range(cfg->freq / 1000000);
+
+	tuning_stats.retunes++;
+	if (fast) {
+		tuning_stats.fast_retunes++;
+	}
+	tuning_stats.last_cycles = DWT_CYCCNT - start;
+	if (tuning_stats.last_cycles > tuning_stats.max_cycles) {
+		tuning_stats.max_cycles = tuning_stats.last_cycles;
+	}
+}
+
+/* Check PLL lock after the last frequency change. */
+bool tuning_locked(void)
+{
+	if (mixer_in_use) {
+		return mixer_locked(&mixer);
+	}
+	return true;
+}
+
+/*
+ * Set freq/tuning between 0MHz to 7250 MHz (less than 16bits really used)
+ * hz between 0 to 999999 Hz (not checked)
+ * return false on error or true if success.
+ */
+bool set_freq(const uint64_t freq)
+{
+	tuning_config_t cfg;
+
+	if (!tuning_compute_freq_cached(&cfg, freq)) {
+		return false;
+	}
+	tuning_set_freq_config(&cfg);
+	return true;
 }
 
 bool set_freq_explicit(const uint64_t if_freq_hz, const uint64_t lo_freq_hz,
@@ -140,13 +347,14 @@ bool set_freq_explicit(const uint64_t if_freq_hz, const uint64_t lo_freq_hz,
 
 	rf_path_set_filter(&rf_path, path);
 	max2837_set_frequency(&max2837, if_freq_hz);
+	applied_valid = false;
 	if (lo_freq_hz > if_freq_hz) {
 		sgpio_cpld_stream_rx_set_q_invert(&sgpio_config, 1);
 	} else {
 		sgpio_cpld_stream_rx_set_q_invert(&sgpio_config, 0);
 	}
 	if (path != RF_PATH_FILTER_BYPASS) {
-		(void)mixer_set_frequency(&mixer, lo_freq_hz / FREQ_ONE_MHZ);
+		(void)mixer_set_frequency(&mixer, lo_freq_hz);
 	}
 	return true;
 }
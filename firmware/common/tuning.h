@@ -24,11 +24,40 @@
 #define __TUNING_H__
 
 #include "rf_path.h"
+#include "mixer.h"
+#include "max2837.h"
 
 #include <stdint.h>
 #include <stdbool.h>
 
+/* Everything needed to tune to one frequency, computed ahead of time. */
+typedef struct {
+	uint64_t freq;
+	rf_path_filter_t filter;
+	bool use_mixer;
+	mixer_config_t mixer;
+	max2837_freq_config_t max2837;
+	uint8_t q_invert;
+} tuning_config_t;
+
+/* Retune counters kept by tuning_set_freq_config. */
+typedef struct {
+	uint32_t retunes;
+	uint32_t fast_retunes;     /* mixer left alone, only the IF moved */
+	uint32_t filter_changes;
+	uint32_t mixer_changes;
+	uint32_t max2837_changes;
+	uint32_t last_cycles;      /* CPU cycles spent in the last retune */
+	uint32_t max_cycles;
+} tuning_stats_t;
+
+extern tuning_stats_t tuning_stats;
+
 bool set_freq(const uint64_t freq);
+bool tuning_compute_freq(tuning_config_t* const cfg, const uint64_t freq);
+bool tuning_compute_freq_cached(tuning_config_t* const cfg, const uint64_t freq);
+void tuning_set_freq_config(const tuning_config_t* const cfg);
+bool tuning_locked(void);
 bool set_freq_explicit(const uint64_t if_freq_hz, const uint64_t lo_freq_hz,
         const rf_path_filter_t path);
 
@@ -257,6 +257,24 @@ void usb_endpoint_flush(
 		usb_flush_primed_endpoints(USB0_ENDPTFLUSH_FERB(1 << endpoint_number));
 	}
 }
+
+// Restart an endpoint after the controller stopped on a failed transfer
+// descriptor: drop anything still primed, then prime the given chain of
+// descriptors, if any.
+void usb_endpoint_reprime(
+	const usb_endpoint_t* const endpoint,
+	usb_transfer_descriptor_t* const first_td
+) {
+	const uint_fast8_t endpoint_number = usb_endpoint_number(endpoint->address);
+	if( usb_endpoint_is_in(endpoint->address) ) {
+		usb_flush_primed_endpoints(USB0_ENDPTFLUSH_FETB(1 << endpoint_number));
+	} else {
+		usb_flush_primed_endpoints(USB0_ENDPTFLUSH_FERB(1 << endpoint_number));
+	}
+	if( first_td != NULL ) {
+		usb_endpoint_prime(endpoint, first_td);
+	}
+}
 /*
 static bool usb_endpoint_is_flushing(
 	const usb_endpoint_t* const endpoint
@@ -280,6 +298,17 @@ bool usb_endpoint_is_ready(
 	}
 }
 
+bool usb_endpoint_is_enabled(
+	const usb_endpoint_t* const endpoint
+) {
+	const uint_fast8_t endpoint_number = usb_endpoint_number(endpoint->address);
+	if( usb_endpoint_is_in(endpoint->address) ) {
+		return USB0_ENDPTCTRL(endpoint_number) & USB0_ENDPTCTRL_TXE;
+	} else {
+		return USB0_ENDPTCTRL(endpoint_number) & USB0_ENDPTCTRL_RXE;
+	}
+}
+
 bool usb_endpoint_is_complete(
 	const usb_endpoint_t* const endpoint
 ) {
@@ -78,11 +78,20 @@ bool usb_endpoint_is_ready(
 	const usb_endpoint_t* const endpoint
 );
 
+bool usb_endpoint_is_enabled(
+	const usb_endpoint_t* const endpoint
+);
+
 void usb_endpoint_prime(
 	const usb_endpoint_t* const endpoint,
 	usb_transfer_descriptor_t* const first_td
 );
 
+void usb_endpoint_reprime(
+	const usb_endpoint_t* const endpoint,
+	usb_transfer_descriptor_t* const first_td
+);
+
 void usb_endpoint_schedule_wait(
 	const usb_endpoint_t* const endpoint,
         usb_transfer_descriptor_t* const td
@@ -32,6 +32,7 @@
 #include "usb_queue.h"
 
 usb_queue_t* endpoint_queues[12] = {};
+usb_queue_errors_t usb_queue_errors;
 
 #define USB_ENDPOINT_INDEX(endpoint_address) (((endpoint_address & 0xF) * 2) + ((endpoint_address >> 7) & 1))
 
@@ -39,7 +40,8 @@ static usb_queue_t* endpoint_queue(
         const usb_endpoint_t* const endpoint
 ) {
         uint32_t index = USB_ENDPOINT_INDEX(endpoint->address);
-        if (endpoint_queues[index] == NULL) while (1);
+        if (endpoint_queues[index] == NULL)
+                usb_queue_errors.missing_queue++;
         return endpoint_queues[index];
 }
 
@@ -57,6 +59,8 @@ void usb_queue_init(
         }
         t->next = NULL;
         t->queue = queue;
+        queue->active = NULL;
+        queue->tail = NULL;
 }
 
 /* Allocate a transfer */
@@ -88,30 +92,40 @@ static void free_transfer(usb_transfer_t* const transfer)
 }
 
 /* Add a transfer to the end of an endpoint's queue. Returns the old
- * tail or NULL is the queue was empty
+ * tail or NULL is the queue was empty. Must be called with interrupts
+ * disabled, as the USB interrupt removes transfers from the head.
  */
 static usb_transfer_t* endpoint_queue_transfer(
         usb_transfer_t* const transfer
 ) {
         usb_queue_t* const queue = transfer->queue;
+        usb_transfer_t* const tail = queue->tail;
         transfer->next = NULL;
-        if (queue->active != NULL) {
-            usb_transfer_t* t = queue->active;
-            while (t->next != NULL) t = t->next;
-            t->next = transfer;
-            return t;
+        queue->tail = transfer;
+        if (tail != NULL) {
+            tail->next = transfer;
+            return tail;
         } else {
             queue->active = transfer;
             return NULL;
         }
 }
+
+/* Remove the transfer at the head of an endpoint's queue. */
+static void endpoint_queue_pop(
+        usb_queue_t* const queue
+) {
+        queue->active = queue->active->next;
+        if (queue->active == NULL)
+                queue->tail = NULL;
+}
                 
 static void usb_queue_flush_queue(usb_queue_t* const queue)
 {
         cm_disable_interrupts();
         while (queue->active) {
                 usb_transfer_t* transfer = queue->active;
-                queue->active = transfer->next;
+                endpoint_queue_pop(queue);
                 free_transfer(transfer);
         }
         cm_enable_interrupts();
@@ -119,7 +133,9 @@ static void usb_queue_flush_queue(usb_queue_t* const queue)
 
 void usb_queue_flush_endpoint(const usb_endpoint_t* const endpoint)
 {
-        usb_queue_flush_queue(endpoint_queue(endpoint));
+        usb_queue_t* const queue = endpoint_queue(endpoint);
+        if (queue == NULL) return;
+        usb_queue_flush_queue(queue);
 }
 
 int usb_transfer_schedule(
@@ -130,6 +146,7 @@ int usb_transfer_schedule(
         void* const user_data
 ) {
         usb_queue_t* const queue = endpoint_queue(endpoint);
+        if (queue == NULL) return -2;
         usb_transfer_t* const transfer = allocate_transfer(queue);
         if (transfer == NULL) return -1;
         usb_transfer_descriptor_t* const td = &transfer->td;
@@ -178,7 +195,7 @@ int usb_transfer_schedule_block(
                 ret = usb_transfer_schedule(endpoint, data, maximum_length,
                                             completion_cb, user_data);
         } while (ret == -1);
-        return 0;
+        return ret;
 }
 
 int usb_transfer_schedule_ack(
@@ -187,11 +204,36 @@ int usb_transfer_schedule_ack(
         return usb_transfer_schedule_block(endpoint, 0, 0, NULL, NULL);
 }
 
+/* The controller stops on a failed transfer. Count it, hand it back to
+ * its owner as a transfer of nothing and restart the endpoint on the
+ * transfers queued behind it, so streaming carries on.
+ */
+static void usb_queue_transfer_failed(
+        usb_queue_t* const queue,
+        usb_transfer_t* const transfer,
+        const uint8_t status
+) {
+        if (status & USB_TD_DTD_TOKEN_STATUS_HALTED)
+                usb_queue_errors.halted++;
+        if (status & USB_TD_DTD_TOKEN_STATUS_BUFFER_ERROR)
+                usb_queue_errors.buffer_errors++;
+        if (status & USB_TD_DTD_TOKEN_STATUS_TRANSACTION_ERROR)
+                usb_queue_errors.transaction_errors++;
+
+        endpoint_queue_pop(queue);
+        usb_endpoint_reprime(queue->endpoint,
+                             queue->active ? &queue->active->td : NULL);
+
+        if (transfer->completion_cb)
+                transfer->completion_cb(transfer->user_data, 0);
+        free_transfer(transfer);
+}
+
 /* Called when an endpoint might have completed a transfer */
 void usb_queue_transfer_complete(usb_endpoint_t* const endpoint)
 {
         usb_queue_t* const queue = endpoint_queue(endpoint);
-        if (queue == NULL) while(1); // Uh oh
+        if (queue == NULL) return;
         usb_transfer_t* transfer = queue->active;
 
         while (transfer != NULL) {
@@ -201,8 +243,9 @@ void usb_queue_transfer_complete(usb_endpoint_t* const endpoint)
                 if (   status & USB_TD_DTD_TOKEN_STATUS_HALTED
                     || status & USB_TD_DTD_TOKEN_STATUS_BUFFER_ERROR
                     || status & USB_TD_DTD_TOKEN_STATUS_TRANSACTION_ERROR) {
-                        // TODO: Uh oh, do something useful here
-                        while (1);
+                        usb_queue_transfer_failed(queue, transfer, status);
+                        transfer = queue->active;
+                        continue;
                 }
 
                 // Still not finished
@@ -211,7 +254,7 @@ void usb_queue_transfer_complete(usb_endpoint_t* const endpoint)
 
                 // Advance the head. We need to do this before invoking the completion
                 // callback as it might attempt to schedule a new transfer
-                queue->active = transfer->next;
+                endpoint_queue_pop(queue);
                 usb_transfer_t* next = transfer->next;
 
                 // Invoke completion callback
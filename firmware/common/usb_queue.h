@@ -47,6 +47,7 @@ struct _usb_queue_t {
         const unsigned int pool_size;
         usb_transfer_t* volatile free_transfers;
         usb_transfer_t* volatile active;
+        usb_transfer_t* volatile tail;
 };
 
 #define USB_DECLARE_QUEUE(endpoint_name)                                \
@@ -59,6 +60,17 @@ struct _usb_queue_t {
                 .pool_size = _pool_size                                 \
         };
 
+// Transfers that failed and were dropped, and requests for endpoints
+// without a queue.
+typedef struct {
+        uint32_t halted;
+        uint32_t buffer_errors;
+        uint32_t transaction_errors;
+        uint32_t missing_queue;
+} usb_queue_errors_t;
+
+extern usb_queue_errors_t usb_queue_errors;
+
 void usb_queue_flush_endpoint(const usb_endpoint_t* const endpoint);
 
 int usb_transfer_schedule(
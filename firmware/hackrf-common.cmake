@@ -64,6 +64,17 @@ endif()
 
 SET(HACKRF_OPTS "-D${BOARD} -DLPC43XX -D${MCU_PARTNO} -DTX_ENABLE -D'VERSION_STRING=\"git-${VERSION}\"'")
 
+# Move baseband samples between SGPIO and the USB bulk buffer with GPDMA
+# instead of the per-32-byte SGPIO interrupt (cmake -DSGPIO_DMA=1).
+if(SGPIO_DMA)
+	SET(HACKRF_OPTS "${HACKRF_OPTS} -DSGPIO_DMA")
+endif()
+
+# Or hand the SGPIO copy loop to the M0 core (cmake -DSGPIO_M0=1).
+if(SGPIO_M0)
+	SET(HACKRF_OPTS "${HACKRF_OPTS} -DSGPIO_M0")
+endif()
+
 SET(LDSCRIPT_M4 "-T${PATH_HACKRF_FIRMWARE_COMMON}/${MCU_PARTNO}_M4_memory.ld -Tlibopencm3_lpc43xx_rom_to_ram.ld -T${PATH_HACKRF_FIRMWARE_COMMON}/LPC43xx_M4_M0_image_from_text.ld")
 
 SET(LDSCRIPT_M4_DFU "-T${PATH_HACKRF_FIRMWARE_COMMON}/${MCU_PARTNO}_M4_memory.ld -Tlibopencm3_lpc43xx.ld -T${PATH_HACKRF_FIRMWARE_COMMON}/LPC43xx_M4_M0_image_from_text.ld")
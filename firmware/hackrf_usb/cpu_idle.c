@@ -0,0 +1,75 @@
+/*
+ * Copyright 2017 Great Scott Gadgets
+ *
+ * This file is part of HackRF.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+
+
+#include "cpu_idle.h"
+
+#include <libopencm3/cm3/cortex.h>
+#include <libopencm3/cm3/dwt.h>
+
+/* The main loop sleeps in WFI whenever it has nothing to do. Interrupt
+ * handlers that leave it work call cpu_idle_wake(), which is checked with
+ * interrupts masked so a wakeup arriving just before WFI isn't lost: WFI
+ * still returns on a pending interrupt while PRIMASK is set.
+ *
+ * Idle time is the cycle count spent inside WFI, total time is the cycle
+ * counter advancing between updates, which happen at least every time
+ * the main loop sleeps or the counters are read.
+ */
+volatile bool cpu_idle_wakeup = false;
+
+static uint32_t last_cycles;
+static cpu_idle_t cpu_idle;
+
+static void cpu_idle_update_total(const uint32_t now) {
+	cpu_idle.total_cycles += now - last_cycles;
+	last_cycles = now;
+}
+
+void cpu_idle_init(void) {
+	dwt_enable_cycle_counter();
+	last_cycles = DWT_CYCCNT;
+}
+
+void cpu_idle_wait(void) {
+	cm_disable_interrupts();
+	while( !cpu_idle_wakeup ) {
+		const uint32_t start = DWT_CYCCNT;
+		__asm__ volatile("wfi");
+		const uint32_t now = DWT_CYCCNT;
+		cpu_idle.idle_cycles += now - start;
+		cpu_idle_update_total(now);
+
+		/* Let the pending interrupt run. */
+		cm_enable_interrupts();
+		cm_disable_interrupts();
+	}
+	cpu_idle_wakeup = false;
+	cpu_idle_update_total(DWT_CYCCNT);
+	cm_enable_interrupts();
+}
+
+/* Called from the USB interrupt, which the main loop masks while it
+ * updates the counters. */
+void cpu_idle_read(cpu_idle_t* const counts) {
+	cpu_idle_update_total(DWT_CYCCNT);
+	*counts = cpu_idle;
+}
@@ -0,0 +1,45 @@
+/*
+ * Copyright 2017 Great Scott Gadgets
+ *
+ * This file is part of HackRF.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+
+
+#ifndef __CPU_IDLE_H__
+#define __CPU_IDLE_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+
+typedef struct {
+	uint64_t idle_cycles;
+	uint64_t total_cycles;
+} cpu_idle_t;
+
+extern volatile bool cpu_idle_wakeup;
+
+/* Called from interrupt handlers that leave work for the main loop. */
+static inline void cpu_idle_wake(void) {
+	cpu_idle_wakeup = true;
+}
+
+void cpu_idle_init(void);
+void cpu_idle_wait(void);
+void cpu_idle_read(cpu_idle_t* const counts);
+
+#endif/*__CPU_IDLE_H__*/
@@ -41,10 +41,13 @@
 #include "usb_api_register.h"
 #include "usb_api_spiflash.h"
 #include "usb_api_operacake.h"
+#include "usb_api_schedule.h"
 #include "operacake.h"
 #include "usb_api_sweep.h"
 #include "usb_api_transceiver.h"
 #include "usb_bulk_buffer.h"
+#include "cpu_idle.h"
+#include "m0_control.h"
  
 #include "hackrf-ui.h"
 
@@ -92,7 +95,24 @@ static const usb_request_handler_fn vendor_request_handler[] = {
 	usb_vendor_request_operacake_set_ranges,
 	usb_vendor_request_set_clkout_enable,
 	usb_vendor_request_spiflash_status,
-	usb_vendor_request_spiflash_clear_status
+	usb_vendor_request_spiflash_clear_status,
+	usb_vendor_request_init_sweep_hops,
+	usb_vendor_request_get_sweep_stats,
+	usb_vendor_request_read_cpu_idle,
+	usb_vendor_request_get_buffer_stats,
+	usb_vendor_request_set_decimation,
+	usb_vendor_request_get_sample_formats,
+	usb_vendor_request_read_usb_errors,
+	usb_vendor_request_switch_direction,
+	usb_vendor_request_get_tuning_stats,
+	usb_vendor_request_set_sample_rate_in_stream,
+	usb_vendor_request_get_rate_change,
+	usb_vendor_request_set_sample_rate_multisynth,
+	usb_vendor_request_apply_config,
+	usb_vendor_request_get_config_result,
+	usb_vendor_request_schedule_command,
+	usb_vendor_request_clear_schedule,
+	usb_vendor_request_get_schedule_stats
 };
 
 static const uint32_t vendor_request_handler_count =
@@ -197,7 +217,11 @@ int main(void) {
 	rf_path_init(&rf_path);
 	operacake_init();
 
-	unsigned int phase = 0;
+#ifdef SGPIO_M0
+	m0_start();
+#endif
+
+	cpu_idle_init();
 
 	while(true) {
 		// Check whether we need to initiate a CPLD update
@@ -210,33 +234,27 @@ int main(void) {
 			sweep_mode();
 		}
 
-		// Set up IN transfer of buffer 0.
-		if ( usb_bulk_buffer_offset >= 16384
-		     && phase == 1
-		     && transceiver_mode() != TRANSCEIVER_MODE_OFF) {
-			usb_transfer_schedule_block(
-				(transceiver_mode() == TRANSCEIVER_MODE_RX)
-				? &usb_endpoint_bulk_in : &usb_endpoint_bulk_out,
-				&usb_bulk_buffer[0x0000],
-				0x4000,
-				NULL, NULL
-				);
-			phase = 0;
+		// Turn the stream around if the host asked to.
+		switch_direction_service();
+
+		// Run commands scheduled for the current stream position.
+		if ( transceiver_mode() != TRANSCEIVER_MODE_OFF ) {
+			schedule_service();
+		}
+
+		if ( usb_bulk_buffer_restart ) {
+			usb_bulk_buffer_restart = false;
+			if ( transceiver_mode() != TRANSCEIVER_MODE_OFF ) {
+				usb_bulk_buffer_ring_start(transceiver_mode());
+			}
 		}
 
-		// Set up IN transfer of buffer 1.
-		if ( usb_bulk_buffer_offset < 16384
-		     && phase == 0
-		     && transceiver_mode() != TRANSCEIVER_MODE_OFF) {
-			usb_transfer_schedule_block(
-				(transceiver_mode() == TRANSCEIVER_MODE_RX)
-				? &usb_endpoint_bulk_in : &usb_endpoint_bulk_out,
-				&usb_bulk_buffer[0x4000],
-				0x4000,
-				NULL, NULL
-			);
-			phase = 1;
+		// Queue every slot SGPIO has finished with.
+		if ( transceiver_mode() != TRANSCEIVER_MODE_OFF ) {
+			usb_bulk_buffer_ring_service(transceiver_mode());
 		}
+
+		cpu_idle_wait();
 	}
 
 	return 0;
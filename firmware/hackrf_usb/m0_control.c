@@ -0,0 +1,81 @@
+/*
+ * Copyright 2017 Great Scott Gadgets
+ *
+ * This file is part of HackRF.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+
+
+#include "m0_control.h"
+#include "m0_state.h"
+
+#include <stdint.h>
+#include <string.h>
+
+#include <libopencm3/cm3/vector.h>
+#include <libopencm3/lpc43xx/creg.h>
+#include <libopencm3/lpc43xx/m4/nvic.h>
+#include <libopencm3/lpc43xx/rgu.h>
+
+#include "cpu_idle.h"
+#include "usb_bulk_buffer.h"
+
+/* Provided by LPC43xx_M4_M0_image_from_text.ld */
+extern uint8_t __m0_start__;
+extern uint8_t __m0_end__;
+
+#define M0_RAM_ADDRESS 0x20000000
+
+/* The M0 signals with SEV each time it finishes a bulk buffer slot. The
+ * M0 can't be held off while the M4 reads the stream position, so the
+ * slot is counted here rather than by the M0 itself. */
+static void m0_isr(void) {
+	CREG_M0TXEVENT = 0;
+	usb_bulk_buffer_slots++;
+	cpu_idle_wake();
+}
+
+/* Copy the M0 image into its RAM and release the M0 from reset. It stays
+ * idle, polling m0_state.mode, until streaming is enabled.
+ */
+void m0_start(void) {
+	memcpy((void*)M0_RAM_ADDRESS, &__m0_start__, &__m0_end__ - &__m0_start__);
+
+	m0_state.buffer = usb_bulk_buffer;
+	m0_state.buffer_mask = usb_bulk_buffer_mask;
+	m0_state.event_mask = USB_BULK_BUFFER_SLOT_SIZE - 1;
+	m0_state.offset = &usb_bulk_buffer_offset;
+	m0_state.mode = M0_MODE_IDLE;
+	m0_state.exchanges = 0;
+
+	vector_table.irq[NVIC_M0CORE_IRQ] = m0_isr;
+	nvic_set_priority(NVIC_M0CORE_IRQ, 0);
+
+	CREG_M0APPMEMMAP = M0_RAM_ADDRESS;
+	RESET_CTRL1 = 0;
+}
+
+void m0_streaming_enable(const bool transmit) {
+	CREG_M0TXEVENT = 0;
+	nvic_enable_irq(NVIC_M0CORE_IRQ);
+	m0_state.mode = transmit ? M0_MODE_TX : M0_MODE_RX;
+}
+
+void m0_streaming_disable(void) {
+	m0_state.mode = M0_MODE_IDLE;
+	nvic_disable_irq(NVIC_M0CORE_IRQ);
+}
@@ -0,0 +1,56 @@
+/*
+ * Copyright 2017 Great Scott Gadgets
+ *
+ * This file is part of HackRF.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+
+
+#ifndef __M0_STATE_H__
+#define __M0_STATE_H__
+
+#include <stdint.h>
+
+/* Shared between the M4 and the M0 streaming program. Lives at the start
+ * of ram_shared (see LPC43xx_M4_memory.ld), which neither core's linker
+ * script places anything in.
+ */
+#define M0_STATE_ADDRESS 0x20007000
+
+typedef enum {
+	M0_MODE_IDLE = 0,
+	M0_MODE_RX = 1,
+	M0_MODE_TX = 2,
+} m0_mode_t;
+
+typedef struct {
+	/* Written by the M4 only while the M0 is idle. */
+	uint8_t* buffer;
+	uint32_t buffer_mask;
+	uint32_t event_mask;
+	volatile uint32_t* offset;
+
+	/* Written by the M4, polled by the M0. */
+	volatile uint32_t mode;
+
+	/* Written by the M0. */
+	volatile uint32_t exchanges;
+} m0_state_t;
+
+#define m0_state (*(m0_state_t*)M0_STATE_ADDRESS)
+
+#endif/*__M0_STATE_H__*/
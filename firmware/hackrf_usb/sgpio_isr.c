@@ -24,7 +24,13 @@
 
 #include <libopencm3/lpc43xx/sgpio.h>
 
+#include <gpdma.h>
+#include <sgpio_dma.h>
+
 #include "usb_bulk_buffer.h"
+#include "cpu_idle.h"
+
+static gpdma_lli_t sgpio_dma_lli[SGPIO_DMA_LLI_COUNT];
 
 void sgpio_isr_rx() {
 	SGPIO_CLR_STATUS_1 = (1 << SGPIO_SLICE_A);
@@ -53,6 +59,10 @@ void sgpio_isr_rx() {
 		: "r0"
 	);
 	usb_bulk_buffer_offset = (usb_bulk_buffer_offset + 32) & usb_bulk_buffer_mask;
+	if( (usb_bulk_buffer_offset & (USB_BULK_BUFFER_SLOT_SIZE - 1)) == 0 ) {
+		usb_bulk_buffer_slots++;
+	}
+	cpu_idle_wake();
 }
 
 void sgpio_isr_tx() {
@@ -82,4 +92,79 @@ void sgpio_isr_tx() {
 		: "r0"
 	);
 	usb_bulk_buffer_offset = (usb_bulk_buffer_offset + 32) & usb_bulk_buffer_mask;
+	if( (usb_bulk_buffer_offset & (USB_BULK_BUFFER_SLOT_SIZE - 1)) == 0 ) {
+		usb_bulk_buffer_slots++;
+	}
+	cpu_idle_wake();
+}
+
+/* Plays out the transmit half of the bulk buffer like sgpio_isr_tx, and
+ * copies each word to the receive half as it is written to SGPIO.
+ */
+void sgpio_isr_tx_echo() {
+	SGPIO_CLR_STATUS_1 = (1 << SGPIO_SLICE_A);
+
+	uint32_t* const p = (uint32_t*)&usb_bulk_buffer[usb_bulk_buffer_offset];
+	uint32_t* const q = (uint32_t*)&usb_bulk_buffer[usb_bulk_buffer_offset + USB_BULK_BUFFER_ECHO_SIZE];
+	__asm__(
+		"ldr r0, [%[p], #0]\n\t"
+		"str r0, [%[SGPIO_REG_SS], #44]\n\t"
+		"str r0, [%[q], #0]\n\t"
+		"ldr r0, [%[p], #4]\n\t"
+		"str r0, [%[SGPIO_REG_SS], #20]\n\t"
+		"str r0, [%[q], #4]\n\t"
+		"ldr r0, [%[p], #8]\n\t"
+		"str r0, [%[SGPIO_REG_SS], #40]\n\t"
+		"str r0, [%[q], #8]\n\t"
+		"ldr r0, [%[p], #12]\n\t"
+		"str r0, [%[SGPIO_REG_SS], #8]\n\t"
+		"str r0, [%[q], #12]\n\t"
+		"ldr r0, [%[p], #16]\n\t"
+		"str r0, [%[SGPIO_REG_SS], #36]\n\t"
+		"str r0, [%[q], #16]\n\t"
+		"ldr r0, [%[p], #20]\n\t"
+		"str r0, [%[SGPIO_REG_SS], #16]\n\t"
+		"str r0, [%[q], #20]\n\t"
+		"ldr r0, [%[p], #24]\n\t"
+		"str r0, [%[SGPIO_REG_SS], #32]\n\t"
+		"str r0, [%[q], #24]\n\t"
+		"ldr r0, [%[p], #28]\n\t"
+		"str r0, [%[SGPIO_REG_SS], #0]\n\t"
+		"str r0, [%[q], #28]\n\t"
+		:
+		: [SGPIO_REG_SS] "l" (SGPIO_PORT_BASE + 0x100),
+		  [p] "l" (p),
+		  [q] "l" (q)
+		: "r0", "memory"
+	);
+	usb_bulk_buffer_offset = (usb_bulk_buffer_offset + 32) & USB_BULK_BUFFER_ECHO_MASK;
+	if( (usb_bulk_buffer_offset & (USB_BULK_BUFFER_SLOT_SIZE - 1)) == 0 ) {
+		usb_bulk_buffer_slots++;
+	}
+	cpu_idle_wake();
+}
+
+void sgpio_dma_isr() {
+	sgpio_dma_irq_tc_acknowledge();
+	usb_bulk_buffer_offset = (usb_bulk_buffer_offset + SGPIO_DMA_TRANSFER_BYTES) & usb_bulk_buffer_mask;
+	if( (usb_bulk_buffer_offset & (USB_BULK_BUFFER_SLOT_SIZE - 1)) == 0 ) {
+		usb_bulk_buffer_slots++;
+	}
+	cpu_idle_wake();
+}
+
+void sgpio_dma_start(const bool direction_transmit) {
+	sgpio_dma_configure_lli(sgpio_dma_lli, SGPIO_DMA_LLI_COUNT,
+		direction_transmit, usb_bulk_buffer, SGPIO_DMA_TRANSFER_BYTES);
+	for(size_t i=0; i<SGPIO_DMA_LLI_COUNT; i++) {
+		gpdma_lli_enable_interrupt(&sgpio_dma_lli[i]);
+	}
+
+	usb_bulk_buffer_offset = 0;
+	sgpio_dma_init();
+	if( direction_transmit ) {
+		sgpio_dma_tx_start(&sgpio_dma_lli[0]);
+	} else {
+		sgpio_dma_rx_start(&sgpio_dma_lli[0]);
+	}
 }
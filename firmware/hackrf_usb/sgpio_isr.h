@@ -23,7 +23,28 @@
 #ifndef __SGPIO_ISR_H__
 #define __SGPIO_ISR_H__
 
+#include <stdbool.h>
+
+/* In DMA mode the bulk buffer is covered by a ring of descriptors, each of
+ * which raises a terminal count interrupt so the offset the USB side polls
+ * keeps advancing in fixed-size steps.
+ */
+#define SGPIO_DMA_LLI_COUNT 8
+#define SGPIO_DMA_TRANSFER_BYTES (sizeof(usb_bulk_buffer) / SGPIO_DMA_LLI_COUNT)
+
+/* How far usb_bulk_buffer_offset moves at a time. Up to this many bytes
+ * have been sampled but are not yet counted in the offset. */
+#if defined(SGPIO_DMA)
+#define SGPIO_OFFSET_STEP SGPIO_DMA_TRANSFER_BYTES
+#else
+#define SGPIO_OFFSET_STEP 32
+#endif
+
 void sgpio_isr_rx();
 void sgpio_isr_tx();
+void sgpio_isr_tx_echo();
+
+void sgpio_dma_isr();
+void sgpio_dma_start(const bool direction_transmit);
 
 #endif/*__SGPIO_ISR_H__*/
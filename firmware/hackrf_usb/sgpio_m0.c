@@ -0,0 +1,86 @@
+/*
+ * Copyright 2017 Great Scott Gadgets
+ *
+ * This file is part of HackRF.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+
+
+/* Streaming program for the M0 core. It polls the SGPIO exchange status
+ * and moves each exchange between the SGPIO shadow registers and the
+ * bulk buffer, exactly like the M4's SGPIO interrupt did, leaving the M4
+ * free to stall in retunes. The M4 is interrupted with SEV each time the
+ * offset crosses an event_mask boundary.
+ */
+
+#include <stdint.h>
+
+#include <libopencm3/lpc43xx/sgpio.h>
+
+#include "m0_state.h"
+
+static void sgpio_m0_rx(uint32_t* const p) {
+	volatile uint32_t* const ss = &SGPIO_REG_SS(0);
+	p[0] = ss[11];
+	p[1] = ss[5];
+	p[2] = ss[10];
+	p[3] = ss[2];
+	p[4] = ss[9];
+	p[5] = ss[4];
+	p[6] = ss[8];
+	p[7] = ss[0];
+}
+
+static void sgpio_m0_tx(const uint32_t* const p) {
+	volatile uint32_t* const ss = &SGPIO_REG_SS(0);
+	ss[11] = p[0];
+	ss[5] = p[1];
+	ss[10] = p[2];
+	ss[2] = p[3];
+	ss[9] = p[4];
+	ss[4] = p[5];
+	ss[8] = p[6];
+	ss[0] = p[7];
+}
+
+int main() {
+	while(1) {
+		const uint32_t mode = m0_state.mode;
+		if( mode == M0_MODE_IDLE ) {
+			continue;
+		}
+		if( (SGPIO_STATUS_1 & (1 << SGPIO_SLICE_A)) == 0 ) {
+			continue;
+		}
+		SGPIO_CLR_STATUS_1 = (1 << SGPIO_SLICE_A);
+
+		uint32_t offset = *m0_state.offset;
+		uint32_t* const p = (uint32_t*)&m0_state.buffer[offset];
+		if( mode == M0_MODE_RX ) {
+			sgpio_m0_rx(p);
+		} else {
+			sgpio_m0_tx(p);
+		}
+		offset = (offset + 32) & m0_state.buffer_mask;
+		*m0_state.offset = offset;
+		m0_state.exchanges++;
+
+		if( (offset & m0_state.event_mask) == 0 ) {
+			__asm__ volatile("sev");
+		}
+	}
+}
@@ -21,6 +21,7 @@
  */
 
 #include "usb_api_board_info.h"
+#include "cpu_idle.h"
 
 #include <hackrf_core.h>
 #include <rom_iap.h>
@@ -101,4 +102,32 @@ usb_request_status_t usb_vendor_request_reset(
 		usb_transfer_schedule_ack(endpoint->in);
 	}
 	return USB_REQUEST_STATUS_OK;
-}
\ No newline at end of file
+}
+
+usb_request_status_t usb_vendor_request_read_cpu_idle(
+	usb_endpoint_t* const endpoint, const usb_transfer_stage_t stage)
+{
+	static cpu_idle_t cpu_idle;
+
+	if (stage == USB_TRANSFER_STAGE_SETUP) {
+		cpu_idle_read(&cpu_idle);
+		usb_transfer_schedule_block(endpoint->in, &cpu_idle, sizeof(cpu_idle),
+					    NULL, NULL);
+		usb_transfer_schedule_ack(endpoint->out);
+	}
+	return USB_REQUEST_STATUS_OK;
+}
+
+usb_request_status_t usb_vendor_request_read_usb_errors(
+	usb_endpoint_t* const endpoint, const usb_transfer_stage_t stage)
+{
+	static usb_queue_errors_t usb_errors;
+
+	if (stage == USB_TRANSFER_STAGE_SETUP) {
+		usb_errors = usb_queue_errors;
+		usb_transfer_schedule_block(endpoint->in, &usb_errors, sizeof(usb_errors),
+					    NULL, NULL);
+		usb_transfer_schedule_ack(endpoint->out);
+	}
+	return USB_REQUEST_STATUS_OK;
+}
@@ -0,0 +1,211 @@
+/*
+ * Copyright 2017 Great Scott Gadgets
+ *
+ * This file is part of HackRF.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+
+
+#include "usb_api_schedule.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include <libopencm3/lpc43xx/m4/nvic.h>
+
+#include <hackrf_core.h>
+#include <max2837.h>
+#include <operacake.h>
+#include <tuning.h>
+#include <usb_queue.h>
+#include "hackrf-ui.h"
+#include "usb_api_transceiver.h"
+#include "usb_bulk_buffer.h"
+
+/*
+ * Commands wait here, sorted by due sample, until the main loop sees the
+ * stream position reach them. The main loop runs every time SGPIO moves
+ * the bulk buffer offset, so a command takes effect within
+ * SGPIO_OFFSET_STEP bytes of its sample plus the time the command itself
+ * takes. Positions count complex samples since streaming was started and
+ * carry on across RX/TX switches.
+ */
+#define SCHEDULE_LENGTH 32
+
+static schedule_command_t schedule[SCHEDULE_LENGTH];
+static uint32_t schedule_count = 0;
+static schedule_command_t incoming_command;
+static schedule_stats_t schedule_stats;
+
+static uint64_t stream_sample(void) {
+	return usb_bulk_buffer_position() / 2;
+}
+
+/* Called from the USB interrupt. Equal due samples keep their order. */
+static bool schedule_insert(const schedule_command_t* const command) {
+	if (schedule_count >= SCHEDULE_LENGTH) {
+		return false;
+	}
+
+	uint32_t i = schedule_count;
+	while ((i > 0) && (schedule[i - 1].sample > command->sample)) {
+		schedule[i] = schedule[i - 1];
+		i--;
+	}
+	schedule[i] = *command;
+	schedule_count++;
+	return true;
+}
+
+static bool schedule_execute(const schedule_command_t* const command) {
+	switch (command->type) {
+	case SCHEDULE_RETUNE:
+		return set_freq(command->arg);
+	case SCHEDULE_LNA_GAIN:
+		if (!max2837_set_lna_gain(&max2837, command->arg)) {
+			return false;
+		}
+		hackrf_ui_setBBLNAGain(command->arg);
+		return true;
+	case SCHEDULE_VGA_GAIN:
+		if (!max2837_set_vga_gain(&max2837, command->arg)) {
+			return false;
+		}
+		hackrf_ui_setBBVGAGain(command->arg);
+		return true;
+	case SCHEDULE_TXVGA_GAIN:
+		if (!max2837_set_txvga_gain(&max2837, command->arg)) {
+			return false;
+		}
+		hackrf_ui_setBBTXVGAGain(command->arg);
+		return true;
+	case SCHEDULE_TX_START:
+		if (transceiver_mode() != TRANSCEIVER_MODE_RX) {
+			return false;
+		}
+		switch_transceiver_direction(TRANSCEIVER_MODE_TX);
+		return true;
+	case SCHEDULE_TX_STOP:
+		if (transceiver_mode() != TRANSCEIVER_MODE_TX) {
+			return false;
+		}
+		switch_transceiver_direction(TRANSCEIVER_MODE_RX);
+		return true;
+	case SCHEDULE_OPERACAKE_PORTS:
+		return operacake_set_ports(command->arg & 0xff,
+			(command->arg >> 8) & 0xff, (command->arg >> 16) & 0xff) == 0;
+	default:
+		return false;
+	}
+}
+
+/*
+ * Drop every pending command. The counters carry on across transceiver
+ * mode changes, so a host can still read them once it has stopped
+ * streaming; only the clear request, with reset_stats set, zeroes them.
+ */
+void schedule_clear(const bool reset_stats) {
+	nvic_disable_irq(NVIC_USB0_IRQ);
+	schedule_count = 0;
+	if (reset_stats) {
+		schedule_stats = (schedule_stats_t){ 0 };
+	} else {
+		schedule_stats.queued = 0;
+	}
+	nvic_enable_irq(NVIC_USB0_IRQ);
+}
+
+/*
+ * Run every command that has come due. Called from the main loop while
+ * streaming. The USB interrupt is held off meanwhile, so control requests
+ * cannot interleave with a command touching the same hardware.
+ */
+void schedule_service(void) {
+	if (schedule_count == 0) {
+		return;
+	}
+
+	nvic_disable_irq(NVIC_USB0_IRQ);
+	while (schedule_count > 0) {
+		const uint64_t now = stream_sample();
+		if (schedule[0].sample > now) {
+			break;
+		}
+
+		const schedule_command_t command = schedule[0];
+		uint32_t i;
+		for (i = 1; i < schedule_count; i++) {
+			schedule[i - 1] = schedule[i];
+		}
+		schedule_count--;
+
+		if (!schedule_execute(&command)) {
+			schedule_stats.failed++;
+		}
+		schedule_stats.executed++;
+		schedule_stats.last_sample = command.sample;
+		schedule_stats.last_executed = now;
+		if ((now - command.sample) > schedule_stats.max_lateness) {
+			schedule_stats.max_lateness = now - command.sample;
+		}
+	}
+	schedule_stats.queued = schedule_count;
+	nvic_enable_irq(NVIC_USB0_IRQ);
+}
+
+usb_request_status_t usb_vendor_request_schedule_command(
+	usb_endpoint_t* const endpoint,
+	const usb_transfer_stage_t stage)
+{
+	if (stage == USB_TRANSFER_STAGE_SETUP) {
+		usb_transfer_schedule_block(endpoint->out, &incoming_command,
+			sizeof(incoming_command), NULL, NULL);
+	} else if (stage == USB_TRANSFER_STAGE_DATA) {
+		if (!schedule_insert(&incoming_command)) {
+			schedule_stats.dropped++;
+			return USB_REQUEST_STATUS_STALL;
+		}
+		schedule_stats.queued = schedule_count;
+		usb_transfer_schedule_ack(endpoint->in);
+	}
+	return USB_REQUEST_STATUS_OK;
+}
+
+usb_request_status_t usb_vendor_request_clear_schedule(
+	usb_endpoint_t* const endpoint,
+	const usb_transfer_stage_t stage)
+{
+	if (stage == USB_TRANSFER_STAGE_SETUP) {
+		schedule_clear(true);
+		usb_transfer_schedule_ack(endpoint->in);
+	}
+	return USB_REQUEST_STATUS_OK;
+}
+
+usb_request_status_t usb_vendor_request_get_schedule_stats(
+	usb_endpoint_t* const endpoint,
+	const usb_transfer_stage_t stage)
+{
+	static schedule_stats_t stats;
+
+	if (stage == USB_TRANSFER_STAGE_SETUP) {
+		stats = schedule_stats;
+		usb_transfer_schedule_block(endpoint->in, &stats, sizeof(stats), NULL, NULL);
+		usb_transfer_schedule_ack(endpoint->out);
+	}
+	return USB_REQUEST_STATUS_OK;
+}
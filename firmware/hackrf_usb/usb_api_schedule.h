@@ -0,0 +1,70 @@
+/*
+ * Copyright 2017 Great Scott Gadgets
+ *
+ * This file is part of HackRF.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+
+
+#ifndef __USB_API_SCHEDULE_H__
+#define __USB_API_SCHEDULE_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <usb_type.h>
+#include <usb_request.h>
+
+/* Commands that can be scheduled for a future sample. */
+typedef enum {
+	SCHEDULE_RETUNE = 0,           /* arg: frequency in Hz */
+	SCHEDULE_LNA_GAIN = 1,         /* arg: gain in dB */
+	SCHEDULE_VGA_GAIN = 2,         /* arg: gain in dB */
+	SCHEDULE_TXVGA_GAIN = 3,       /* arg: gain in dB */
+	SCHEDULE_TX_START = 4,         /* switch a running stream to TX */
+	SCHEDULE_TX_STOP = 5,          /* switch a running stream back to RX */
+	SCHEDULE_OPERACAKE_PORTS = 6,  /* arg: address | (PA << 8) | (PB << 16) */
+} schedule_command_type_t;
+
+typedef struct {
+	uint64_t sample;  /* stream position the command is due at */
+	uint64_t arg;
+	uint32_t type;
+	uint32_t reserved;
+} schedule_command_t;
+
+typedef struct {
+	uint32_t queued;        /* commands waiting */
+	uint32_t executed;
+	uint32_t failed;        /* executed but rejected, e.g. bad frequency */
+	uint32_t dropped;       /* refused because the queue was full */
+	uint32_t max_lateness;  /* samples between due and executed */
+	uint32_t reserved;
+	uint64_t last_sample;   /* due position of the last command run */
+	uint64_t last_executed; /* stream position when it ran */
+} schedule_stats_t;
+
+usb_request_status_t usb_vendor_request_schedule_command(
+	usb_endpoint_t* const endpoint, const usb_transfer_stage_t stage);
+usb_request_status_t usb_vendor_request_clear_schedule(
+	usb_endpoint_t* const endpoint, const usb_transfer_stage_t stage);
+usb_request_status_t usb_vendor_request_get_schedule_stats(
+	usb_endpoint_t* const endpoint, const usb_transfer_stage_t stage);
+
+void schedule_clear(const bool reset_stats);
+void schedule_service(void);
+
+#endif /* __USB_API_SCHEDULE_H__ */
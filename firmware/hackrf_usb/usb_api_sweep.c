@@ -27,12 +27,20 @@
 #include "usb_bulk_buffer.h"
 #include "tuning.h"
 #include "usb_endpoint.h"
+#include "cpu_idle.h"
 
 #define MIN(x,y)       ((x)<(y)?(x):(y))
 #define MAX(x,y)       ((x)>(y)?(x):(y))
 #define FREQ_GRANULARITY 1000000
 #define MAX_RANGES 10
 #define THROWAWAY_BUFFERS 2
+#define MAX_HOPS 512
+#define HOP_ENTRY_SIZE 10
+#define MAX_HOPS_PER_CHUNK 25
+/* Hop frequencies must be below this, the top of the 7250 MHz band. */
+#define MAX_HOP_FREQ ((uint64_t)7251 * FREQ_GRANULARITY)
+/* Give up waiting for PLL lock after half a block of samples. */
+#define LOCK_TIMEOUT_BYTES 0x2000
 
 volatile bool start_sweep_mode = false;
 static uint64_t sweep_freq;
@@ -43,6 +51,20 @@ static uint32_t dwell_blocks = 0;
 static uint32_t step_width = 0;
 static uint32_t offset = 0;
 static enum sweep_style style = LINEAR;
+static uint64_t hop_freqs[MAX_HOPS];
+static uint16_t hop_dwell_blocks[MAX_HOPS];
+static uint64_t staged_hop_freqs[MAX_HOPS];
+static uint16_t staged_hop_dwell_blocks[MAX_HOPS];
+static unsigned char hop_data[MAX_HOPS_PER_CHUNK * HOP_ENTRY_SIZE];
+static uint16_t num_hops = 0;
+static uint16_t num_staged_hops = 0;
+/* Set by the USB handler once a complete hop list is staged, cleared by
+ * sweep_mode() when it has taken the list. */
+static volatile bool hops_pending = false;
+static uint16_t range;
+static uint16_t hop;
+static bool odd;
+static sweep_stats_t sweep_stats;
 
 usb_request_status_t usb_vendor_request_init_sweep(
 		usb_endpoint_t* const endpoint, const usb_transfer_stage_t stage)
@@ -73,26 +95,211 @@ usb_request_status_t usb_vendor_request_init_sweep(
 		if(INTERLEAVED < style) {
 			return USB_REQUEST_STATUS_STALL;
 		}
+		/* A hop list not yet taken by sweep_mode() would replace
+		 * these ranges. */
+		if(hops_pending) {
+			return USB_REQUEST_STATUS_STALL;
+		}
+		num_hops = 0;
 		for(i=0; i<(num_ranges*2); i++) {
 			frequencies[i] = ((uint16_t)(data[10+i*2]) << 8) + data[9+i*2];
 		}
 		sweep_freq = (uint64_t)frequencies[0] * FREQ_GRANULARITY;
 		set_freq(sweep_freq + offset);
 		start_sweep_mode = true;
+		cpu_idle_wake();
 		usb_transfer_schedule_ack(endpoint->in);
 	}
 	return USB_REQUEST_STATUS_OK;
 }
 
+/*
+ * The hop list is sent in chunks of up to MAX_HOPS_PER_CHUNK entries.
+ * setup.value is the index of the first entry in the chunk and setup.index
+ * is the total number of entries in the list. Each entry is a 64-bit
+ * frequency in Hz followed by a 16-bit dwell time in blocks, both little
+ * endian. Chunks must be sent in order and are staged until the last one
+ * has been received. The complete list is then handed to sweep_mode(),
+ * which switches to it between hops and starts from its first entry; a
+ * sweep already running keeps going through the previous list until then.
+ * Chunks are refused while a complete list is waiting to be taken.
+ */
+usb_request_status_t usb_vendor_request_init_sweep_hops(
+		usb_endpoint_t* const endpoint, const usb_transfer_stage_t stage)
+{
+	uint16_t first, total, count;
+	int i, j;
+	first = endpoint->setup.value;
+	total = endpoint->setup.index;
+	count = endpoint->setup.length / HOP_ENTRY_SIZE;
+	if (stage == USB_TRANSFER_STAGE_SETUP) {
+		if((1 > total) || (MAX_HOPS < total)) {
+			return USB_REQUEST_STATUS_STALL;
+		}
+		if((1 > count) || (MAX_HOPS_PER_CHUNK < count)
+				|| (endpoint->setup.length % HOP_ENTRY_SIZE)
+				|| ((first + count) > total)) {
+			return USB_REQUEST_STATUS_STALL;
+		}
+		usb_transfer_schedule_block(endpoint->out, &hop_data,
+				endpoint->setup.length, NULL, NULL);
+	} else if (stage == USB_TRANSFER_STAGE_DATA) {
+		if(hops_pending) {
+			return USB_REQUEST_STATUS_STALL;
+		}
+		/* A chunk starting at 0 begins a new list, anything else must
+		 * follow on from the previous chunk. */
+		if((0 != first) && (first != num_staged_hops)) {
+			num_staged_hops = 0;
+			return USB_REQUEST_STATUS_STALL;
+		}
+		for(i=0; i<count; i++) {
+			staged_hop_freqs[first+i] = 0;
+			for(j=7; j>=0; j--) {
+				staged_hop_freqs[first+i] = (staged_hop_freqs[first+i] << 8)
+						| hop_data[i*HOP_ENTRY_SIZE + j];
+			}
+			staged_hop_dwell_blocks[first+i] = ((uint16_t)(hop_data[i*HOP_ENTRY_SIZE + 9]) << 8)
+					| hop_data[i*HOP_ENTRY_SIZE + 8];
+			if((1 > staged_hop_dwell_blocks[first+i])
+					|| (MAX_HOP_FREQ <= staged_hop_freqs[first+i])) {
+				num_staged_hops = 0;
+				return USB_REQUEST_STATUS_STALL;
+			}
+		}
+		num_staged_hops = first + count;
+		if(num_staged_hops == total) {
+			/* Retuning is left to sweep_mode(), it may be part way
+			 * through a retune of its own. */
+			hops_pending = true;
+			start_sweep_mode = true;
+			cpu_idle_wake();
+		}
+		usb_transfer_schedule_ack(endpoint->in);
+	}
+	return USB_REQUEST_STATUS_OK;
+}
+
+usb_request_status_t usb_vendor_request_get_sweep_stats(
+		usb_endpoint_t* const endpoint, const usb_transfer_stage_t stage)
+{
+	if (stage == USB_TRANSFER_STAGE_SETUP) {
+		usb_transfer_schedule_block(endpoint->in, &sweep_stats,
+				sizeof(sweep_stats), NULL, NULL);
+		usb_transfer_schedule_ack(endpoint->out);
+	}
+	return USB_REQUEST_STATUS_OK;
+}
+
+/* Switch to the hop list staged by usb_vendor_request_init_sweep_hops(),
+ * at its first hop. The caller retunes. No chunk is accepted while
+ * hops_pending is set, so the staged list is stable while it is copied.
+ */
+static void sweep_take_hops(void)
+{
+	uint16_t i;
+
+	for(i=0; i<num_staged_hops; i++) {
+		hop_freqs[i] = staged_hop_freqs[i];
+		hop_dwell_blocks[i] = staged_hop_dwell_blocks[i];
+	}
+	num_hops = num_staged_hops;
+	num_staged_hops = 0;
+	hop = 0;
+	offset = 0;
+	/* The request that published the list has been acted on. */
+	start_sweep_mode = false;
+	hops_pending = false;
+}
+
+/* Advance freq to the next step of the sweep and set the dwell for it. */
+static void sweep_step(uint64_t* const freq, uint32_t* const blocks)
+{
+	if(num_hops > 0) {
+		hop = (hop + 1) % num_hops;
+		*freq = hop_freqs[hop];
+		*blocks = hop_dwell_blocks[hop];
+		return;
+	}
+	if(INTERLEAVED == style) {
+		if(!odd && ((*freq + step_width) >= ((uint64_t)frequencies[1+range*2] * FREQ_GRANULARITY))) {
+			range = (range + 1) % num_ranges;
+			*freq = (uint64_t)frequencies[range*2] * FREQ_GRANULARITY;
+		} else {
+			if(odd) {
+				*freq += step_width/4;
+			} else {
+				*freq += 3*step_width/4;
+			}
+		}
+		odd = !odd;
+	} else {
+		if((*freq + step_width) >= ((uint64_t)frequencies[1+range*2] * FREQ_GRANULARITY)) {
+			range = (range + 1) % num_ranges;
+			*freq = (uint64_t)frequencies[range*2] * FREQ_GRANULARITY;
+		} else {
+			*freq += step_width;
+		}
+	}
+}
+
+/*
+ * Wait for the PLL to lock after a retune that started when the bulk buffer
+ * offset was at start. Returns the number of bytes captured in the meantime.
+ */
+static uint32_t sweep_wait_lock(const uint32_t start)
+{
+	while(!tuning_locked()) {
+		if(((usb_bulk_buffer_offset - start) & usb_bulk_buffer_mask) >= LOCK_TIMEOUT_BYTES) {
+			sweep_stats.lock_timeouts++;
+			break;
+		}
+	}
+	return (usb_bulk_buffer_offset - start) & usb_bulk_buffer_mask;
+}
+
 void sweep_mode(void) {
 	unsigned int blocks_queued = 0;
+	unsigned int throwaway_blocks = THROWAWAY_BUFFERS;
 	unsigned int phase = 1;
-	bool odd = true;
-	uint16_t range = 0;
+	uint32_t retune_start;
+	uint32_t retune_bytes;
+	uint64_t next_freq;
+	uint32_t next_dwell_blocks;
+	tuning_config_t next_tuning;
+	bool next_valid;
 
 	uint8_t *buffer;
 	bool transfer = false;
 
+	/* Receive slots may have gone out ahead of the sweep, when streaming
+	 * was started before it. The host looks for a tagged block every
+	 * 0x4000 bytes, so line the stream up on that first. */
+	usb_bulk_buffer_ring_drain(0x4000);
+
+	if(hops_pending) {
+		sweep_take_hops();
+		sweep_freq = hop_freqs[0];
+		dwell_blocks = hop_dwell_blocks[0];
+		set_freq(sweep_freq);
+	}
+
+	range = 0;
+	hop = 0;
+	odd = true;
+	sweep_stats.hops = 0;
+	sweep_stats.last_retune_samples = 0;
+	sweep_stats.max_retune_samples = 0;
+	sweep_stats.lock_timeouts = 0;
+	sweep_stats.discarded_blocks = 0;
+
+	/* Tuning settings for the next step are always computed one step
+	 * ahead, while the current step is being captured. */
+	next_freq = sweep_freq;
+	next_dwell_blocks = dwell_blocks;
+	sweep_step(&next_freq, &next_dwell_blocks);
+	next_valid = tuning_compute_freq_cached(&next_tuning, next_freq + offset);
+
 	while(transceiver_mode() != TRANSCEIVER_MODE_OFF) {
 		// Set up IN transfer of buffer 0.
 		if ( usb_bulk_buffer_offset >= 16384 && phase == 1) {
@@ -121,40 +328,54 @@ void sweep_mode(void) {
 			*(buffer+7) = (sweep_freq >> 40) & 0xff;
 			*(buffer+8) = (sweep_freq >> 48) & 0xff;
 			*(buffer+9) = (sweep_freq >> 56) & 0xff;
-			if (blocks_queued > THROWAWAY_BUFFERS) {
+			if (blocks_queued > throwaway_blocks) {
 				usb_transfer_schedule_block(
 					&usb_endpoint_bulk_in,
 					buffer,
 					0x4000,
 					NULL, NULL
 				);
+			} else {
+				sweep_stats.discarded_blocks++;
 			}
 			transfer = false;
 		}
 
-		if ((dwell_blocks + THROWAWAY_BUFFERS) <= blocks_queued) {
-			if(INTERLEAVED == style) {
-				if(!odd && ((sweep_freq + step_width) >= ((uint64_t)frequencies[1+range*2] * FREQ_GRANULARITY))) {
-					range = (range + 1) % num_ranges;
-					sweep_freq = (uint64_t)frequencies[range*2] * FREQ_GRANULARITY;
-				} else {
-					if(odd) {
-						sweep_freq += step_width/4;
-					} else {
-						sweep_freq += 3*step_width/4;
-					}
-				}
-				odd = !odd;
-			} else {
-				if((sweep_freq + step_width) >= ((uint64_t)frequencies[1+range*2] * FREQ_GRANULARITY)) {
-					range = (range + 1) % num_ranges;
-					sweep_freq = (uint64_t)frequencies[range*2] * FREQ_GRANULARITY;
-				} else {
-					sweep_freq += step_width;
-				}
+		/* A new hop list: retune to its first hop now, dropping what
+		 * was computed ahead from the old one. */
+		if(hops_pending) {
+			sweep_take_hops();
+			next_freq = hop_freqs[0];
+			next_dwell_blocks = hop_dwell_blocks[0];
+			next_valid = tuning_compute_freq_cached(&next_tuning, next_freq + offset);
+			blocks_queued = dwell_blocks + throwaway_blocks;
+		}
+
+		if ((dwell_blocks + throwaway_blocks) <= blocks_queued) {
+			retune_start = usb_bulk_buffer_offset;
+			if(next_valid) {
+				tuning_set_freq_config(&next_tuning);
 			}
-			set_freq(sweep_freq + offset);
+			sweep_freq = next_freq;
+			dwell_blocks = next_dwell_blocks;
+			retune_bytes = sweep_wait_lock(retune_start);
+
+			/* Every block holding samples from before lock is thrown away:
+			 * the one being filled when the retune started and any block
+			 * boundaries crossed until lock. */
+			throwaway_blocks = 1 + ((retune_start & 0x3fff) + retune_bytes) / 0x4000;
 			blocks_queued = 0;
+
+			sweep_stats.hops++;
+			sweep_stats.last_retune_samples = retune_bytes / 2;
+			if(sweep_stats.last_retune_samples > sweep_stats.max_retune_samples) {
+				sweep_stats.max_retune_samples = sweep_stats.last_retune_samples;
+			}
+
+			sweep_step(&next_freq, &next_dwell_blocks);
+			next_valid = tuning_compute_freq_cached(&next_tuning, next_freq + offset);
 		}
+
+		cpu_idle_wait();
 	}
 }
@@ -33,8 +33,21 @@ enum sweep_style {
 	INTERLEAVED = 1,
 };
 
+/* Retune timing, in samples, as returned to the host. */
+typedef struct {
+	uint32_t hops;
+	uint32_t last_retune_samples;
+	uint32_t max_retune_samples;
+	uint32_t lock_timeouts;
+	uint32_t discarded_blocks;
+} sweep_stats_t;
+
 usb_request_status_t usb_vendor_request_init_sweep(
 	usb_endpoint_t* const endpoint, const usb_transfer_stage_t stage);
+usb_request_status_t usb_vendor_request_init_sweep_hops(
+	usb_endpoint_t* const endpoint, const usb_transfer_stage_t stage);
+usb_request_status_t usb_vendor_request_get_sweep_stats(
+	usb_endpoint_t* const endpoint, const usb_transfer_stage_t stage);
 
 void sweep_mode(void);
 
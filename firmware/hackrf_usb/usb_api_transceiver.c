@@ -24,21 +24,32 @@
 
 #include "hackrf-ui.h"
 #include <libopencm3/cm3/vector.h>
+#include <libopencm3/cm3/dwt.h>
 #include <libopencm3/lpc43xx/m4/nvic.h>
 #include "sgpio_isr.h"
+#include "m0_control.h"
+
+#if defined(SGPIO_DMA) && defined(SGPIO_M0)
+#error "SGPIO_DMA and SGPIO_M0 are alternatives"
+#endif
 
 #include "usb_api_cpld.h" // Remove when CPLD update is handled elsewhere
 
 #include <max2837.h>
 #include <rf_path.h>
 #include <tuning.h>
+#include <decimator.h>
 #include <streaming.h>
 #include <usb.h>
 #include <usb_queue.h>
 
 #include <stddef.h>
+#include <string.h>
 
 #include "usb_endpoint.h"
+#include "usb_bulk_buffer.h"
+#include "usb_api_schedule.h"
+#include "cpu_idle.h"
 
 typedef struct {
 	uint32_t freq_mhz;
@@ -102,6 +113,14 @@ usb_request_status_t usb_vendor_request_set_freq(
 	}
 }
 
+/* The decimator can't keep up with input above DECIMATOR_MAX_INPUT_RATE_HZ,
+ * so refuse rates of freq_hz / divider above that while it is enabled. */
+static bool decimation_rate_ok(const uint64_t freq_hz, const uint32_t divider)
+{
+	return (usb_bulk_buffer_decimator == NULL)
+		|| (freq_hz <= (uint64_t)DECIMATOR_MAX_INPUT_RATE_HZ * divider);
+}
+
 usb_request_status_t usb_vendor_request_set_sample_rate_frac(
 	usb_endpoint_t* const endpoint,
 	const usb_transfer_stage_t stage) 
@@ -113,6 +132,10 @@ usb_request_status_t usb_vendor_request_set_sample_rate_frac(
 		return USB_REQUEST_STATUS_OK;
 	} else if (stage == USB_TRANSFER_STAGE_DATA) 
 	{
+		if( !decimation_rate_ok(set_sample_r_params.freq_hz, set_sample_r_params.divider) )
+		{
+			return USB_REQUEST_STATUS_STALL;
+		}
 		if( sample_rate_frac_set(set_sample_r_params.freq_hz * 2, set_sample_r_params.divider ) )
 		{
 			usb_transfer_schedule_ack(endpoint->in);
@@ -125,6 +148,112 @@ usb_request_status_t usb_vendor_request_set_sample_rate_frac(
 	}
 }
 
+typedef struct {
+	uint32_t p1;
+	uint32_t p2;
+	uint32_t p3;
+	uint32_t r_div;
+	uint32_t bandwidth_hz; /* 0 leaves the baseband filter alone */
+} set_multisynth_params_t;
+
+static set_multisynth_params_t multisynth_params;
+
+/* Take the Si5351C MS0 parameters as solved by the host, so the rate is
+ * exactly the one the host reported rather than a firmware approximation. */
+usb_request_status_t usb_vendor_request_set_sample_rate_multisynth(
+	usb_endpoint_t* const endpoint,
+	const usb_transfer_stage_t stage)
+{
+	if( stage == USB_TRANSFER_STAGE_SETUP ) {
+		usb_transfer_schedule_block(endpoint->out, &multisynth_params,
+			sizeof(multisynth_params), NULL, NULL);
+	} else if( stage == USB_TRANSFER_STAGE_DATA ) {
+		if( !decimation_rate_ok(sample_rate_multisynth_hz(multisynth_params.p1,
+				multisynth_params.p2, multisynth_params.p3,
+				multisynth_params.r_div), 1) ) {
+			return USB_REQUEST_STATUS_STALL;
+		}
+		if( !sample_rate_multisynth_set(multisynth_params.p1,
+				multisynth_params.p2, multisynth_params.p3,
+				multisynth_params.r_div) ) {
+			return USB_REQUEST_STATUS_STALL;
+		}
+		if( multisynth_params.bandwidth_hz
+				&& !baseband_filter_bandwidth_set(multisynth_params.bandwidth_hz) ) {
+			return USB_REQUEST_STATUS_STALL;
+		}
+		usb_transfer_schedule_ack(endpoint->in);
+	}
+	return USB_REQUEST_STATUS_OK;
+}
+
+typedef struct {
+	uint32_t freq_hz;
+	uint32_t divider;
+	uint32_t bandwidth_hz; /* 0 leaves the baseband filter alone */
+} set_sample_rate_in_stream_params_t;
+
+static set_sample_rate_in_stream_params_t rate_in_stream_params;
+static rate_change_t rate_change;
+
+/*
+ * Change the sample rate and baseband filter without touching the stream.
+ * The stream positions either side of the change are recorded so the
+ * host can tell which samples were taken at which rate.
+ */
+usb_request_status_t usb_vendor_request_set_sample_rate_in_stream(
+	usb_endpoint_t* const endpoint,
+	const usb_transfer_stage_t stage)
+{
+	if( stage == USB_TRANSFER_STAGE_SETUP ) {
+		usb_transfer_schedule_block(endpoint->out, &rate_in_stream_params,
+			sizeof(rate_in_stream_params), NULL, NULL);
+	} else if( stage == USB_TRANSFER_STAGE_DATA ) {
+		const bool streaming = (transceiver_mode() != TRANSCEIVER_MODE_OFF);
+		const uint64_t before = streaming ? usb_bulk_buffer_position() : 0;
+
+		if( !decimation_rate_ok(rate_in_stream_params.freq_hz,
+				rate_in_stream_params.divider) ) {
+			return USB_REQUEST_STATUS_STALL;
+		}
+		if( !sample_rate_frac_set(rate_in_stream_params.freq_hz * 2,
+				rate_in_stream_params.divider) ) {
+			return USB_REQUEST_STATUS_STALL;
+		}
+		if( rate_in_stream_params.bandwidth_hz
+				&& !baseband_filter_bandwidth_set(rate_in_stream_params.bandwidth_hz) ) {
+			return USB_REQUEST_STATUS_STALL;
+		}
+
+		const uint64_t after = streaming ? usb_bulk_buffer_position() : 0;
+
+		/* Samples still in the SGPIO shift registers when the change
+		 * finished may have been taken before it. */
+		rate_change.glitch_start = before / 2;
+		rate_change.first_sample = streaming ? ((after + SGPIO_OFFSET_STEP) / 2) : 0;
+		rate_change.freq_hz = rate_in_stream_params.freq_hz;
+		rate_change.divider = rate_in_stream_params.divider;
+		rate_change.bandwidth_hz = rate_in_stream_params.bandwidth_hz;
+		rate_change.changes++;
+		usb_transfer_schedule_ack(endpoint->in);
+	}
+	return USB_REQUEST_STATUS_OK;
+}
+
+usb_request_status_t usb_vendor_request_get_rate_change(
+	usb_endpoint_t* const endpoint,
+	const usb_transfer_stage_t stage)
+{
+	static rate_change_t change;
+
+	if( stage == USB_TRANSFER_STAGE_SETUP ) {
+		change = rate_change;
+		usb_transfer_schedule_block(endpoint->in, &change, sizeof(change), NULL, NULL);
+		usb_transfer_schedule_ack(endpoint->out);
+	}
+	return USB_REQUEST_STATUS_OK;
+}
+
 usb_request_status_t usb_vendor_request_set_amp_enable(
 	usb_endpoint_t* const endpoint, const usb_transfer_stage_t stage)
 {
@@ -244,49 +373,284 @@ transceiver_mode_t transceiver_mode(void) {
 	return _transceiver_mode;
 }
 
-void set_transceiver_mode(const transceiver_mode_t new_transceiver_mode) {
+static void baseband_stop(void) {
+#ifdef SGPIO_DMA
+	baseband_streaming_dma_disable(&sgpio_config);
+	/* GPDMA can only follow a single slice, the multislice shadow
+	 * registers are not at consecutive addresses. */
+	sgpio_set_slice_mode(&sgpio_config, false);
+#elif defined(SGPIO_M0)
+	sgpio_cpld_stream_disable(&sgpio_config);
+	m0_streaming_disable();
+#else
 	baseband_streaming_disable(&sgpio_config);
-	
-	usb_endpoint_disable(&usb_endpoint_bulk_in);
-	usb_endpoint_disable(&usb_endpoint_bulk_out);
-	
-	_transceiver_mode = new_transceiver_mode;
-	
+#endif
+}
+
+static void baseband_start(void) {
+#ifdef SGPIO_DMA
+	vector_table.irq[NVIC_DMA_IRQ] = sgpio_dma_isr;
+	sgpio_dma_start(_transceiver_mode == TRANSCEIVER_MODE_TX);
+	baseband_streaming_dma_enable(&sgpio_config);
+#elif defined(SGPIO_M0)
+	m0_streaming_enable(_transceiver_mode == TRANSCEIVER_MODE_TX);
+	sgpio_cpld_stream_enable(&sgpio_config);
+#else
+	baseband_streaming_enable(&sgpio_config);
+#endif
+}
+
+/* Point the RF path and SGPIO at the current mode. */
+static void baseband_set_direction(void) {
 	if( _transceiver_mode == TRANSCEIVER_MODE_RX ) {
 		led_off(LED3);
 		led_on(LED2);
-		usb_endpoint_init(&usb_endpoint_bulk_in);
 		rf_path_set_direction(&rf_path, RF_PATH_DIRECTION_RX);
 		vector_table.irq[NVIC_SGPIO_IRQ] = sgpio_isr_rx;
 	} else if (_transceiver_mode == TRANSCEIVER_MODE_TX) {
 		led_off(LED2);
 		led_on(LED3);
-		usb_endpoint_init(&usb_endpoint_bulk_out);
 		rf_path_set_direction(&rf_path, RF_PATH_DIRECTION_TX);
+		/* SGPIO starts on a slot the host hasn't filled, and after a
+		 * switch from RX the others still hold received samples. Play
+		 * silence until the host's first slot comes round. */
+		memset(usb_bulk_buffer, 0, sizeof(usb_bulk_buffer));
 		vector_table.irq[NVIC_SGPIO_IRQ] = sgpio_isr_tx;
+	} else if (_transceiver_mode == TRANSCEIVER_MODE_TX_ECHO) {
+		led_on(LED2);
+		led_on(LED3);
+		/* A debug mode for the streaming path only: the radio stays off
+		 * and SGPIO is clocked out with nothing behind it, so nothing is
+		 * transmitted. */
+		rf_path_set_direction(&rf_path, RF_PATH_DIRECTION_OFF);
+		sgpio_configure(&sgpio_config, SGPIO_DIRECTION_TX);
+		vector_table.irq[NVIC_SGPIO_IRQ] = sgpio_isr_tx_echo;
 	} else {
 		led_off(LED2);
 		led_off(LED3);
 		rf_path_set_direction(&rf_path, RF_PATH_DIRECTION_OFF);
 		vector_table.irq[NVIC_SGPIO_IRQ] = sgpio_isr_rx;
 	}
+}
+
+void set_transceiver_mode(const transceiver_mode_t new_transceiver_mode) {
+	baseband_stop();
 
+	/* The stream position restarts, so pending commands are meaningless. */
+	usb_bulk_buffer_position_reset(false);
+	schedule_clear(false);
+	
+	usb_endpoint_disable(&usb_endpoint_bulk_in);
+	usb_endpoint_disable(&usb_endpoint_bulk_out);
+	
+	_transceiver_mode = new_transceiver_mode;
+	usb_bulk_buffer_restart = true;
+	cpu_idle_wake();
+	
+	if( (_transceiver_mode == TRANSCEIVER_MODE_RX)
+	 || (_transceiver_mode == TRANSCEIVER_MODE_TX_ECHO) ) {
+		usb_endpoint_init(&usb_endpoint_bulk_in);
+	}
+	if( (_transceiver_mode == TRANSCEIVER_MODE_TX)
+	 || (_transceiver_mode == TRANSCEIVER_MODE_TX_ECHO) ) {
+		usb_endpoint_init(&usb_endpoint_bulk_out);
+	}
+	baseband_set_direction();
 
 	if( _transceiver_mode != TRANSCEIVER_MODE_OFF ) {
 		si5351c_activate_best_clock_source(&clock_gen);
 
         hw_sync_enable(_hw_sync_mode);
 
-		baseband_streaming_enable(&sgpio_config);
+		baseband_start();
+	}
+}
+
+/* Turn a running stream around between RX and TX. Only called from the
+ * main loop, between services of the bulk buffer ring. Unlike
+ * set_transceiver_mode the bulk endpoint of the old direction stays
+ * enabled, so transfers the host keeps submitting on it simply wait, and
+ * the clock source and hw sync setup are left alone. Only samples already
+ * queued on the endpoints are dropped. The stream position keeps counting
+ * across the switch, so scheduled commands stay on the same timeline.
+ */
+void switch_transceiver_direction(const transceiver_mode_t new_transceiver_mode) {
+	baseband_stop();
+	usb_bulk_buffer_position_reset(true);
+
+	/* Re-initialising a live endpoint would reset its data toggle, so
+	 * only the endpoint set_transceiver_mode left disabled is brought up. */
+	if( usb_endpoint_is_enabled(&usb_endpoint_bulk_in) ) {
+		usb_endpoint_flush(&usb_endpoint_bulk_in);
+	} else {
+		usb_endpoint_init(&usb_endpoint_bulk_in);
+	}
+	if( usb_endpoint_is_enabled(&usb_endpoint_bulk_out) ) {
+		usb_endpoint_flush(&usb_endpoint_bulk_out);
+	} else {
+		usb_endpoint_init(&usb_endpoint_bulk_out);
+	}
+
+	_transceiver_mode = new_transceiver_mode;
+	usb_bulk_buffer_restart = true;
+	cpu_idle_wake();
+
+	baseband_set_direction();
+	baseband_start();
+}
+
+static config_bundle_t config_bundle;
+static config_result_t config_result;
+
+static bool config_mode_valid(const uint32_t mode) {
+	switch( mode ) {
+	case TRANSCEIVER_MODE_TX_ECHO:
+#if defined(SGPIO_DMA) || defined(SGPIO_M0)
+		return false;
+#endif
+		/* fall through */
+	case TRANSCEIVER_MODE_OFF:
+	case TRANSCEIVER_MODE_RX:
+	case TRANSCEIVER_MODE_TX:
+		return true;
+	default:
+		return false;
 	}
 }
 
+/*
+ * Apply a bundle of settings in one go. Streaming is stopped first if the
+ * mode is changing, then the clock (slowest to settle) goes first and
+ * the gain writes overlap with synthesizer settling. The new mode is
+ * entered last, so no samples are taken with half the settings applied.
+ */
+static void config_bundle_apply(const config_bundle_t* const bundle,
+		config_result_t* const result)
+{
+	const uint32_t flags = bundle->flags;
+	uint32_t failed = 0;
+	bool mode_change = false;
+
+	if( flags & CONFIG_TRANSCEIVER_MODE ) {
+		if( !config_mode_valid(bundle->transceiver_mode) ) {
+			failed |= CONFIG_TRANSCEIVER_MODE;
+		} else if( bundle->transceiver_mode != _transceiver_mode ) {
+			mode_change = true;
+			if( _transceiver_mode != TRANSCEIVER_MODE_OFF ) {
+				set_transceiver_mode(TRANSCEIVER_MODE_OFF);
+			}
+		}
+	}
+
+	if( flags & CONFIG_SAMPLE_RATE ) {
+		if( !decimation_rate_ok(bundle->sample_rate_hz,
+				bundle->sample_rate_divider) ) {
+			failed |= CONFIG_SAMPLE_RATE;
+		} else if( !sample_rate_frac_set(bundle->sample_rate_hz * 2,
+				bundle->sample_rate_divider) ) {
+			failed |= CONFIG_SAMPLE_RATE;
+		}
+	}
+	if( flags & CONFIG_BASEBAND_FILTER ) {
+		if( !baseband_filter_bandwidth_set(bundle->bandwidth_hz) ) {
+			failed |= CONFIG_BASEBAND_FILTER;
+		}
+	}
+	if( flags & CONFIG_FREQ ) {
+		const uint64_t freq = bundle->freq_mhz * 1000000ULL + bundle->freq_hz;
+		if( !set_freq(freq) ) {
+			failed |= CONFIG_FREQ;
+		}
+	}
+	if( flags & CONFIG_LNA_GAIN ) {
+		if( max2837_set_lna_gain(&max2837, bundle->lna_gain) ) {
+			hackrf_ui_setBBLNAGain(bundle->lna_gain);
+		} else {
+			failed |= CONFIG_LNA_GAIN;
+		}
+	}
+	if( flags & CONFIG_VGA_GAIN ) {
+		if( max2837_set_vga_gain(&max2837, bundle->vga_gain) ) {
+			hackrf_ui_setBBVGAGain(bundle->vga_gain);
+		} else {
+			failed |= CONFIG_VGA_GAIN;
+		}
+	}
+	if( flags & CONFIG_TXVGA_GAIN ) {
+		if( max2837_set_txvga_gain(&max2837, bundle->txvga_gain) ) {
+			hackrf_ui_setBBTXVGAGain(bundle->txvga_gain);
+		} else {
+			failed |= CONFIG_TXVGA_GAIN;
+		}
+	}
+	if( flags & CONFIG_AMP ) {
+		if( bundle->amp_enable <= 1 ) {
+			rf_path_set_lna(&rf_path, bundle->amp_enable);
+		} else {
+			failed |= CONFIG_AMP;
+		}
+	}
+	if( flags & CONFIG_ANTENNA ) {
+		if( bundle->antenna_enable <= 1 ) {
+			rf_path_set_antenna(&rf_path, bundle->antenna_enable);
+		} else {
+			failed |= CONFIG_ANTENNA;
+		}
+	}
+
+	if( mode_change && (bundle->transceiver_mode != TRANSCEIVER_MODE_OFF) ) {
+		set_transceiver_mode(bundle->transceiver_mode);
+	}
+
+	result->applied = flags & ~failed;
+	result->failed = failed;
+	result->transceiver_mode = _transceiver_mode;
+}
+
+/* A bundle that is only partly applied is still acknowledged, the host
+ * reads config_result to see which settings were rejected. */
+usb_request_status_t usb_vendor_request_apply_config(
+	usb_endpoint_t* const endpoint,
+	const usb_transfer_stage_t stage)
+{
+	if( stage == USB_TRANSFER_STAGE_SETUP ) {
+		usb_transfer_schedule_block(endpoint->out, &config_bundle,
+			sizeof(config_bundle), NULL, NULL);
+	} else if( stage == USB_TRANSFER_STAGE_DATA ) {
+		const uint32_t start = DWT_CYCCNT;
+		config_bundle_apply(&config_bundle, &config_result);
+		config_result.cycles = DWT_CYCCNT - start;
+		usb_transfer_schedule_ack(endpoint->in);
+	}
+	return USB_REQUEST_STATUS_OK;
+}
+
+usb_request_status_t usb_vendor_request_get_config_result(
+	usb_endpoint_t* const endpoint,
+	const usb_transfer_stage_t stage)
+{
+	static config_result_t result;
+
+	if( stage == USB_TRANSFER_STAGE_SETUP ) {
+		result = config_result;
+		usb_transfer_schedule_block(endpoint->in, &result, sizeof(result), NULL, NULL);
+		usb_transfer_schedule_ack(endpoint->out);
+	}
+	return USB_REQUEST_STATUS_OK;
+}
+
 usb_request_status_t usb_vendor_request_set_transceiver_mode(
 	usb_endpoint_t* const endpoint,
 	const usb_transfer_stage_t stage)
 {
 	if( stage == USB_TRANSFER_STAGE_SETUP ) {
 		switch( endpoint->setup.value ) {
+		case TRANSCEIVER_MODE_TX_ECHO:
+#if defined(SGPIO_DMA) || defined(SGPIO_M0)
+			/* The receive copy is made by the SGPIO interrupt. */
+			return USB_REQUEST_STATUS_STALL;
+#endif
+			/* fall through */
 		case TRANSCEIVER_MODE_OFF:
 		case TRANSCEIVER_MODE_RX:
 		case TRANSCEIVER_MODE_TX:
@@ -296,6 +660,7 @@ usb_request_status_t usb_vendor_request_set_transceiver_mode(
 		case TRANSCEIVER_MODE_CPLD_UPDATE:
 			usb_endpoint_init(&usb_endpoint_bulk_out);
 			start_cpld_update = true;
+			cpu_idle_wake();
 			usb_transfer_schedule_ack(endpoint->in);
 			return USB_REQUEST_STATUS_OK;
 		default:
@@ -306,6 +671,65 @@ usb_request_status_t usb_vendor_request_set_transceiver_mode(
 	}
 }
 
+/* A switch requested over USB is left to the main loop, which may be in
+ * the middle of queueing a slot on the endpoint the switch flushes. */
+static volatile bool switch_pending = false;
+static transceiver_mode_t switch_mode;
+static usb_endpoint_t* switch_endpoint;
+
+/* Returns the number of CPU cycles the switch took, once the main loop
+ * has carried it out. */
+usb_request_status_t usb_vendor_request_switch_direction(
+	usb_endpoint_t* const endpoint,
+	const usb_transfer_stage_t stage)
+{
+	if( stage == USB_TRANSFER_STAGE_SETUP ) {
+		if( (transceiver_mode() != TRANSCEIVER_MODE_RX)
+		 && (transceiver_mode() != TRANSCEIVER_MODE_TX) ) {
+			return USB_REQUEST_STATUS_STALL;
+		}
+		switch( endpoint->setup.value ) {
+		case TRANSCEIVER_MODE_RX:
+		case TRANSCEIVER_MODE_TX:
+			switch_mode = endpoint->setup.value;
+			switch_endpoint = endpoint;
+			switch_pending = true;
+			cpu_idle_wake();
+			return USB_REQUEST_STATUS_OK;
+		default:
+			return USB_REQUEST_STATUS_STALL;
+		}
+	} else {
+		return USB_REQUEST_STATUS_OK;
+	}
+}
+
+/* Called from the main loop, before the bulk buffer ring is serviced. The
+ * USB interrupt is held off so no other request changes the mode under
+ * the switch. */
+void switch_direction_service(void) {
+	static uint32_t switch_cycles;
+
+	if( !switch_pending ) {
+		return;
+	}
+
+	nvic_disable_irq(NVIC_USB0_IRQ);
+	switch_pending = false;
+	if( (transceiver_mode() == TRANSCEIVER_MODE_RX)
+	 || (transceiver_mode() == TRANSCEIVER_MODE_TX) ) {
+		switch_cycles = DWT_CYCCNT;
+		switch_transceiver_direction(switch_mode);
+		switch_cycles = DWT_CYCCNT - switch_cycles;
+		usb_transfer_schedule_block(switch_endpoint->in, &switch_cycles,
+				sizeof(switch_cycles), NULL, NULL);
+		usb_transfer_schedule_ack(switch_endpoint->out);
+	} else {
+		usb_endpoint_stall(switch_endpoint);
+	}
+	nvic_enable_irq(NVIC_USB0_IRQ);
+}
+
 usb_request_status_t usb_vendor_request_set_hw_sync_mode(
 	usb_endpoint_t* const endpoint,
 	const usb_transfer_stage_t stage)
@@ -318,3 +742,83 @@ usb_request_status_t usb_vendor_request_set_hw_sync_mode(
 		return USB_REQUEST_STATUS_OK;
 	}
 }
+
+usb_request_status_t usb_vendor_request_get_buffer_stats(
+	usb_endpoint_t* const endpoint,
+	const usb_transfer_stage_t stage)
+{
+	static usb_bulk_buffer_stats_t stats;
+
+	if( stage == USB_TRANSFER_STAGE_SETUP ) {
+		stats = usb_bulk_buffer_stats;
+		usb_transfer_schedule_block(endpoint->in, &stats, sizeof(stats), NULL, NULL);
+		usb_transfer_schedule_ack(endpoint->out);
+	}
+	return USB_REQUEST_STATUS_OK;
+}
+
+usb_request_status_t usb_vendor_request_get_tuning_stats(
+	usb_endpoint_t* const endpoint,
+	const usb_transfer_stage_t stage)
+{
+	static tuning_stats_t stats;
+
+	if( stage == USB_TRANSFER_STAGE_SETUP ) {
+		stats = tuning_stats;
+		usb_transfer_schedule_block(endpoint->in, &stats, sizeof(stats), NULL, NULL);
+		usb_transfer_schedule_ack(endpoint->out);
+	}
+	return USB_REQUEST_STATUS_OK;
+}
+
+static decimator_t rx_decimator;
+static uint32_t decimation_phase_increment;
+
+/* wValue: decimation ratio, 0 or 1 to disable
+ * wIndex: output format, see decimator_format_t
+ * data:   NCO phase increment per input sample, 2^32 being the sample rate
+ * Stalls if the sample rate is above DECIMATOR_MAX_INPUT_RATE_HZ.
+ */
+usb_request_status_t usb_vendor_request_set_decimation(
+	usb_endpoint_t* const endpoint,
+	const usb_transfer_stage_t stage)
+{
+	if( stage == USB_TRANSFER_STAGE_SETUP ) {
+		/* The decimator is run from the main loop while streaming. */
+		if( _transceiver_mode != TRANSCEIVER_MODE_OFF ) {
+			return USB_REQUEST_STATUS_STALL;
+		}
+		if( endpoint->setup.value <= 1 ) {
+			usb_bulk_buffer_decimator = NULL;
+			usb_transfer_schedule_ack(endpoint->in);
+			return USB_REQUEST_STATUS_OK;
+		}
+		usb_transfer_schedule_block(endpoint->out, &decimation_phase_increment,
+			sizeof(decimation_phase_increment), NULL, NULL);
+	} else if( stage == USB_TRANSFER_STAGE_DATA ) {
+		if( (sample_rate_get() > DECIMATOR_MAX_INPUT_RATE_HZ)
+				|| !decimator_configure(&rx_decimator, endpoint->setup.value,
+				endpoint->setup.index, decimation_phase_increment) ) {
+			usb_bulk_buffer_decimator = NULL;
+			return USB_REQUEST_STATUS_STALL;
+		}
+		usb_bulk_buffer_decimator = &rx_decimator;
+		usb_transfer_schedule_ack(endpoint->in);
+	}
+	return USB_REQUEST_STATUS_OK;
+}
+
+/* Bitmask of the decimator_format_t values the decimator can produce. */
+usb_request_status_t usb_vendor_request_get_sample_formats(
+	usb_endpoint_t* const endpoint,
+	const usb_transfer_stage_t stage)
+{
+	static uint32_t formats;
+
+	if( stage == USB_TRANSFER_STAGE_SETUP ) {
+		formats = DECIMATOR_FORMATS;
+		usb_transfer_schedule_block(endpoint->in, &formats, sizeof(formats), NULL, NULL);
+		usb_transfer_schedule_ack(endpoint->out);
+	}
+	return USB_REQUEST_STATUS_OK;
+}
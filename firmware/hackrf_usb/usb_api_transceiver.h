@@ -27,10 +27,57 @@
 #include <usb_type.h>
 #include <usb_request.h>
 
+/* Where the last in-stream sample rate change landed. Positions count
+ * complex samples from the start of streaming, before any decimation. */
+typedef struct {
+	uint64_t glitch_start;  /* first sample that may be affected */
+	uint64_t first_sample;  /* first sample taken at the new rate */
+	uint32_t freq_hz;
+	uint32_t divider;
+	uint32_t bandwidth_hz;
+	uint32_t changes;       /* in-stream changes made since power on */
+} rate_change_t;
+
+/* Settings in a config bundle, applied only when their flag is set. */
+#define CONFIG_FREQ             (1 << 0)
+#define CONFIG_SAMPLE_RATE      (1 << 1)
+#define CONFIG_BASEBAND_FILTER  (1 << 2)
+#define CONFIG_LNA_GAIN         (1 << 3)
+#define CONFIG_VGA_GAIN         (1 << 4)
+#define CONFIG_TXVGA_GAIN       (1 << 5)
+#define CONFIG_AMP              (1 << 6)
+#define CONFIG_ANTENNA          (1 << 7)
+#define CONFIG_TRANSCEIVER_MODE (1 << 8)
+
+typedef struct {
+	uint32_t flags;
+	uint32_t freq_mhz;
+	uint32_t freq_hz;
+	uint32_t sample_rate_hz;      /* rate is sample_rate_hz / divider */
+	uint32_t sample_rate_divider;
+	uint32_t bandwidth_hz;
+	uint32_t lna_gain;
+	uint32_t vga_gain;
+	uint32_t txvga_gain;
+	uint32_t amp_enable;
+	uint32_t antenna_enable;
+	uint32_t transceiver_mode;
+} config_bundle_t;
+
+typedef struct {
+	uint32_t applied;          /* flags of settings that took effect */
+	uint32_t failed;           /* flags of settings that were rejected */
+	uint32_t transceiver_mode; /* mode after the bundle */
+	uint32_t cycles;           /* CPU cycles spent applying it */
+} config_result_t;
+
 void set_hw_sync_mode(const hw_sync_mode_t new_hw_sync_mode);
 usb_request_status_t usb_vendor_request_set_transceiver_mode(
 	usb_endpoint_t* const endpoint,
 	const usb_transfer_stage_t stage);
+usb_request_status_t usb_vendor_request_switch_direction(
+	usb_endpoint_t* const endpoint,
+	const usb_transfer_stage_t stage);
 usb_request_status_t usb_vendor_request_set_baseband_filter_bandwidth(
 	usb_endpoint_t* const endpoint,
 	const usb_transfer_stage_t stage);
@@ -40,6 +87,21 @@ usb_request_status_t usb_vendor_request_set_freq(
 usb_request_status_t usb_vendor_request_set_sample_rate_frac(
 	usb_endpoint_t* const endpoint,
 	const usb_transfer_stage_t stage);
+usb_request_status_t usb_vendor_request_set_sample_rate_multisynth(
+	usb_endpoint_t* const endpoint,
+	const usb_transfer_stage_t stage);
+usb_request_status_t usb_vendor_request_set_sample_rate_in_stream(
+	usb_endpoint_t* const endpoint,
+	const usb_transfer_stage_t stage);
+usb_request_status_t usb_vendor_request_get_rate_change(
+	usb_endpoint_t* const endpoint,
+	const usb_transfer_stage_t stage);
+usb_request_status_t usb_vendor_request_apply_config(
+	usb_endpoint_t* const endpoint,
+	const usb_transfer_stage_t stage);
+usb_request_status_t usb_vendor_request_get_config_result(
+	usb_endpoint_t* const endpoint,
+	const usb_transfer_stage_t stage);
 usb_request_status_t usb_vendor_request_set_amp_enable(
 	usb_endpoint_t* const endpoint, const usb_transfer_stage_t stage);
 usb_request_status_t usb_vendor_request_set_lna_gain(
@@ -55,9 +117,19 @@ usb_request_status_t usb_vendor_request_set_freq_explicit(
 	usb_endpoint_t* const endpoint, const usb_transfer_stage_t stage);
 usb_request_status_t usb_vendor_request_set_hw_sync_mode(
 	usb_endpoint_t* const endpoint,	const usb_transfer_stage_t stage);
+usb_request_status_t usb_vendor_request_get_buffer_stats(
+	usb_endpoint_t* const endpoint, const usb_transfer_stage_t stage);
+usb_request_status_t usb_vendor_request_get_tuning_stats(
+	usb_endpoint_t* const endpoint, const usb_transfer_stage_t stage);
+usb_request_status_t usb_vendor_request_set_decimation(
+	usb_endpoint_t* const endpoint, const usb_transfer_stage_t stage);
+usb_request_status_t usb_vendor_request_get_sample_formats(
+	usb_endpoint_t* const endpoint, const usb_transfer_stage_t stage);
 
 transceiver_mode_t transceiver_mode(void);
 void set_transceiver_mode(const transceiver_mode_t new_transceiver_mode);
+void switch_transceiver_direction(const transceiver_mode_t new_transceiver_mode);
+void switch_direction_service(void);
 void start_streaming_on_hw_sync();
 
 #endif/*__USB_API_TRANSCEIVER_H__*/
@@ -22,5 +22,223 @@
 
 #include "usb_bulk_buffer.h"
 
+#include <stddef.h>
+
+#include <libopencm3/cm3/cortex.h>
+
+#include "usb_endpoint.h"
+#include "usb_api_transceiver.h"
+#include "cpu_idle.h"
+#include <usb_queue.h>
+
 const uint32_t usb_bulk_buffer_mask = 32768 - 1;
 volatile uint32_t usb_bulk_buffer_offset = 0;
+volatile uint32_t usb_bulk_buffer_slots = 0;
+
+usb_bulk_buffer_stats_t usb_bulk_buffer_stats;
+volatile bool usb_bulk_buffer_restart = false;
+decimator_t* usb_bulk_buffer_decimator = NULL;
+
+static volatile bool slot_queued[USB_BULK_BUFFER_SLOT_COUNT];
+/* Bytes the host has taken from the bulk IN endpoint since the ring was
+ * started. */
+static volatile uint32_t bytes_in;
+static uint32_t next_slot;
+static uint32_t producer_slot;
+/* Slots SGPIO cycles through, half of them in TX echo mode. */
+static uint32_t ring_slot_count = USB_BULK_BUFFER_SLOT_COUNT;
+/* Stream position at the last reset, non-zero when a direction switch
+ * carries the old stream's position over. */
+static volatile uint64_t position_base;
+
+static uint32_t current_slot(void) {
+	return (usb_bulk_buffer_offset & usb_bulk_buffer_mask) / USB_BULK_BUFFER_SLOT_SIZE;
+}
+
+static void slot_transfer_complete(void* user_data, unsigned int bytes_transferred)
+{
+	(void)bytes_transferred;
+	const uint32_t slot = (uint32_t)user_data;
+
+	slot_queued[slot] = false;
+	usb_bulk_buffer_stats.transfers++;
+	usb_bulk_buffer_stats.in_flight--;
+	cpu_idle_wake();
+}
+
+static void slot_transfer_in_complete(void* user_data, unsigned int bytes_transferred)
+{
+	bytes_in += bytes_transferred;
+	slot_transfer_complete(user_data, bytes_transferred);
+}
+
+static void slot_advance(void)
+{
+	next_slot = (next_slot + 1) % ring_slot_count;
+}
+
+static void slot_schedule(const uint32_t slot, const bool transmit, const bool decimate)
+{
+	uint8_t* const data = &usb_bulk_buffer[slot * USB_BULK_BUFFER_SLOT_SIZE];
+	uint32_t length = USB_BULK_BUFFER_SLOT_SIZE;
+
+	if( decimate && (usb_bulk_buffer_decimator != NULL) ) {
+		length = decimator_execute(usb_bulk_buffer_decimator, data, length);
+	}
+
+	cm_disable_interrupts();
+	slot_queued[slot] = true;
+	usb_bulk_buffer_stats.in_flight++;
+	if( usb_bulk_buffer_stats.in_flight > usb_bulk_buffer_stats.max_in_flight ) {
+		usb_bulk_buffer_stats.max_in_flight = usb_bulk_buffer_stats.in_flight;
+	}
+	cm_enable_interrupts();
+
+	usb_transfer_schedule_block(
+		transmit ? &usb_endpoint_bulk_out : &usb_endpoint_bulk_in,
+		data,
+		length,
+		transmit ? slot_transfer_complete : slot_transfer_in_complete,
+		(void*)slot
+	);
+}
+
+/* Forget all queued slots, the endpoint queue is flushed whenever the
+ * transceiver mode changes. For transmit every slot but the one SGPIO is
+ * reading is handed to the host straight away, to fill ahead of SGPIO.
+ */
+void usb_bulk_buffer_ring_start(const transceiver_mode_t mode)
+{
+	const bool transmit = (mode == TRANSCEIVER_MODE_TX)
+		|| (mode == TRANSCEIVER_MODE_TX_ECHO);
+	uint32_t i;
+
+	for(i=0; i<USB_BULK_BUFFER_SLOT_COUNT; i++) {
+		slot_queued[i] = false;
+	}
+	usb_bulk_buffer_stats = (usb_bulk_buffer_stats_t){ 0 };
+	bytes_in = 0;
+
+	if( mode == TRANSCEIVER_MODE_TX_ECHO ) {
+		ring_slot_count = USB_BULK_BUFFER_SLOT_COUNT / 2;
+	} else {
+		ring_slot_count = USB_BULK_BUFFER_SLOT_COUNT;
+	}
+
+	producer_slot = current_slot();
+	next_slot = producer_slot;
+	if( transmit ) {
+		for(i=1; i<ring_slot_count; i++) {
+			slot_schedule((producer_slot + i) % ring_slot_count, true, false);
+		}
+	}
+}
+
+void usb_bulk_buffer_ring_service(const transceiver_mode_t mode)
+{
+	const uint32_t slot = current_slot();
+
+	if( slot == producer_slot ) {
+		return;
+	}
+	producer_slot = slot;
+
+	/* SGPIO has started on a slot whose transfer hasn't finished: receive
+	 * data not yet sent is being overwritten, or transmit data not yet
+	 * received is being played out. */
+	if( slot_queued[slot] ) {
+		usb_bulk_buffer_stats.overruns++;
+		usb_bulk_buffer_stats.slot_overruns[slot]++;
+	}
+
+	if( mode == TRANSCEIVER_MODE_TX_ECHO ) {
+		/* The receive copy of this slot is about to be overwritten. */
+		if( slot_queued[slot + ring_slot_count] ) {
+			usb_bulk_buffer_stats.overruns++;
+			usb_bulk_buffer_stats.slot_overruns[slot + ring_slot_count]++;
+		}
+
+		/* Send the copy of what was just played out, then hand the
+		 * transmit slot back to the host for refilling. */
+		while( next_slot != slot ) {
+			if( !slot_queued[next_slot + ring_slot_count] ) {
+				slot_schedule(next_slot + ring_slot_count, false, false);
+			}
+			if( !slot_queued[next_slot] ) {
+				slot_schedule(next_slot, true, false);
+			}
+			slot_advance();
+		}
+		return;
+	}
+
+	while( next_slot != slot ) {
+		if( !slot_queued[next_slot] ) {
+			slot_schedule(next_slot, mode == TRANSCEIVER_MODE_TX,
+				mode == TRANSCEIVER_MODE_RX);
+		}
+		slot_advance();
+	}
+}
+
+/* Stop feeding the ring to the host and wait for the slots already queued
+ * to be taken, then pad the IN stream out to a multiple of align bytes.
+ * Whatever is sent on bulk IN next starts on that boundary, which is how
+ * sweep mode's blocks are found by the host. Gives up if streaming stops.
+ */
+void usb_bulk_buffer_ring_drain(const uint32_t align)
+{
+	uint32_t i;
+	bool queued;
+
+	do {
+		queued = false;
+		for(i=0; i<USB_BULK_BUFFER_SLOT_COUNT; i++) {
+			queued |= slot_queued[i];
+		}
+		if( queued ) {
+			cpu_idle_wait();
+		}
+	} while( queued && (transceiver_mode() != TRANSCEIVER_MODE_OFF) );
+
+	const uint32_t pad = (align - (bytes_in % align)) % align;
+	if( pad && (transceiver_mode() != TRANSCEIVER_MODE_OFF) ) {
+		/* The padding never covers a block boundary, its contents
+		 * don't matter. */
+		usb_transfer_schedule_block(&usb_endpoint_bulk_in,
+			&usb_bulk_buffer[0], pad, NULL, NULL);
+		bytes_in += pad;
+	}
+}
+
+/* Bytes SGPIO has moved through since the position was reset, counted
+ * before any decimation. The slot count may trail the offset by less than
+ * a ring, so only the offset's distance past the counted boundary is
+ * added. Safe to call from interrupt handlers. */
+uint64_t usb_bulk_buffer_position(void)
+{
+	const uint32_t ring_mask = (transceiver_mode() == TRANSCEIVER_MODE_TX_ECHO)
+		? USB_BULK_BUFFER_ECHO_MASK : usb_bulk_buffer_mask;
+
+	const uint32_t primask = cm_mask_interrupts(1);
+	const uint64_t counted = (uint64_t)usb_bulk_buffer_slots * USB_BULK_BUFFER_SLOT_SIZE;
+	const uint64_t position = position_base + counted
+		+ ((usb_bulk_buffer_offset - (uint32_t)counted) & ring_mask);
+	cm_mask_interrupts(primask);
+
+	return position;
+}
+
+/* Called with SGPIO stopped, before it is started again from the start of
+ * the bulk buffer. With keep set the position carries on from where the
+ * old stream stopped rather than restarting at zero. */
+void usb_bulk_buffer_position_reset(const bool keep)
+{
+	const uint64_t position = keep ? usb_bulk_buffer_position() : 0;
+
+	const uint32_t primask = cm_mask_interrupts(1);
+	usb_bulk_buffer_offset = 0;
+	usb_bulk_buffer_slots = 0;
+	position_base = position;
+	cm_mask_interrupts(primask);
+}
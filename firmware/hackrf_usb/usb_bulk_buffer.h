@@ -24,6 +24,10 @@
 #define __USB_BULK_BUFFER_H__
 
 #include <stdint.h>
+#include <stdbool.h>
+
+#include <hackrf_core.h>
+#include <decimator.h>
 
 /* Address of usb_bulk_buffer is set in ldscripts. If you change the name of this
  * variable, it won't be where it needs to be in the processor's address space,
@@ -35,4 +39,46 @@ extern const uint32_t usb_bulk_buffer_mask;
 
 extern volatile uint32_t usb_bulk_buffer_offset;
 
+/* Slot boundaries usb_bulk_buffer_offset has crossed since the stream
+ * position was last reset. Counted wherever the offset is advanced, so it
+ * never waits on the main loop. On the M0 build it is counted by the M4
+ * when the M0 signals a finished slot and may trail the offset slightly.
+ */
+extern volatile uint32_t usb_bulk_buffer_slots;
+
+/* The bulk buffer is handled as a ring of equal slots. A slot is queued on
+ * the bulk endpoint as soon as SGPIO has moved past it, so up to
+ * USB_BULK_BUFFER_SLOT_COUNT - 1 transfers can be in flight while the
+ * host is slow to service the endpoint.
+ */
+#define USB_BULK_BUFFER_SLOT_COUNT 4
+#define USB_BULK_BUFFER_SLOT_SIZE (sizeof(usb_bulk_buffer) / USB_BULK_BUFFER_SLOT_COUNT)
+
+/* In TX echo mode the first half of the bulk buffer is the transmit ring
+ * and the second half the receive ring. SGPIO only walks the transmit half,
+ * every word it plays out is copied to the same offset in the receive half.
+ */
+#define USB_BULK_BUFFER_ECHO_SIZE (sizeof(usb_bulk_buffer) / 2)
+#define USB_BULK_BUFFER_ECHO_MASK (USB_BULK_BUFFER_ECHO_SIZE - 1)
+
+typedef struct {
+	uint32_t transfers;      /* USB transfers completed */
+	uint32_t overruns;       /* SGPIO reached a slot still queued for USB */
+	uint32_t in_flight;      /* slots currently queued on the endpoint */
+	uint32_t max_in_flight;
+	uint32_t slot_overruns[USB_BULK_BUFFER_SLOT_COUNT];
+} usb_bulk_buffer_stats_t;
+
+extern usb_bulk_buffer_stats_t usb_bulk_buffer_stats;
+extern volatile bool usb_bulk_buffer_restart;
+
+/* When set, receive slots are decimated in place before being queued. */
+extern decimator_t* usb_bulk_buffer_decimator;
+
+void usb_bulk_buffer_ring_start(const transceiver_mode_t mode);
+void usb_bulk_buffer_ring_service(const transceiver_mode_t mode);
+void usb_bulk_buffer_ring_drain(const uint32_t align);
+uint64_t usb_bulk_buffer_position(void);
+void usb_bulk_buffer_position_reset(const bool keep);
+
 #endif/*__USB_BULK_BUFFER_H__*/
@@ -0,0 +1,229 @@
+/*
+ * Copyright 2017 Great Scott Gadgets
+ *
+ * This file is part of HackRF.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+
+
+/*
+ * Host test of decimator_execute(). A fixed input is run through the
+ * decimator in uneven chunks, for every output format at the smallest and
+ * largest ratio, and compared bit for bit with a direct form model of the
+ * same NCO and CIC filter and with known good output.
+ */
+
+#include "decimator.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+#define CIC_ORDER 3
+#define MIXER_SHIFT 11
+#define MIXER_BITS 13
+#define GAIN_BITS 30
+
+#define SAMPLE_COUNT (DECIMATOR_RATIO_MAX * 24)
+#define PHASE_INCREMENT 0x0a3d70a4 /* 1/25 of the sample rate */
+#define GOLDEN_LENGTH 12
+
+typedef struct {
+	uint32_t ratio;
+	decimator_format_t format;
+	uint8_t golden[GOLDEN_LENGTH];
+} test_case_t;
+
+/* First output bytes of each case, taken from the decimator as
+ * checked against the model below. */
+static const test_case_t test_cases[] = {
+	{  2, DECIMATOR_FORMAT_CS8,
+		{ 0x1d, 0xde, 0x23, 0xaf, 0xf8, 0xa8, 0xcf, 0xb6, 0xb2, 0xd7, 0xa7, 0x02 } },
+	{ 64, DECIMATOR_FORMAT_CS8,
+		{ 0xfe, 0xfd, 0xfd, 0xfd, 0x00, 0xff, 0xff, 0xff, 0x00, 0xff, 0xff, 0x00 } },
+	{  2, DECIMATOR_FORMAT_CS16,
+		{ 0x8e, 0x1d, 0x4f, 0xde, 0x62, 0x23, 0x46, 0xaf, 0xea, 0xf8, 0x3b, 0xa8 } },
+	{ 64, DECIMATOR_FORMAT_CS16,
+		{ 0x8e, 0xfe, 0x7b, 0xfd, 0xf5, 0xfd, 0xe9, 0xfd, 0x2d, 0x00, 0xea, 0xff } },
+	{  2, DECIMATOR_FORMAT_CS12,
+		{ 0xd8, 0x41, 0xde, 0x36, 0x42, 0xaf, 0x8e, 0x3f, 0xa8, 0xf0, 0xdc, 0xb6 } },
+	{ 64, DECIMATOR_FORMAT_CS12,
+		{ 0xe8, 0x7f, 0xfd, 0xdf, 0xef, 0xfd, 0x02, 0xe0, 0xff, 0xfd, 0xff, 0xff } },
+};
+
+/* Chunk lengths in bytes, used in turn. */
+static const size_t chunk_lengths[] = { 2, 130, 998, 64, 4094, 18 };
+
+static int8_t input[SAMPLE_COUNT * 2];
+static uint8_t output[SAMPLE_COUNT * 2];
+static uint8_t expected[SAMPLE_COUNT * 2];
+static int32_t mixed_i[SAMPLE_COUNT];
+static int32_t mixed_q[SAMPLE_COUNT];
+static int64_t kernel[CIC_ORDER * DECIMATOR_RATIO_MAX];
+
+/* Full scale DC for the first quarter, to drive the output into
+ * saturation, then noise. */
+static void make_input(void)
+{
+	uint32_t lcg = 12345;
+	int n;
+
+	for(n=0; n<SAMPLE_COUNT; n++) {
+		if(n < (SAMPLE_COUNT / 4)) {
+			input[n*2] = 127;
+			input[n*2+1] = -128;
+		} else {
+			lcg = lcg * 1103515245 + 12345;
+			input[n*2] = (int8_t)(lcg >> 24);
+			input[n*2+1] = (int8_t)(lcg >> 16);
+		}
+	}
+}
+
+static int32_t saturate(const int64_t value, const int32_t limit)
+{
+	return (value >= limit) ? (limit - 1) : (value < -limit) ? -limit : (int32_t)value;
+}
+
+/* Direct form model: mix to DC, convolve with the CIC impulse response
+ * (a boxcar of length ratio, CIC_ORDER times over) and keep every ratio'th
+ * result. Returns the number of output bytes. */
+static size_t model(const uint32_t ratio, const decimator_format_t format)
+{
+	const int output_bits = (format == DECIMATOR_FORMAT_CS16) ? 16
+		: (format == DECIMATOR_FORMAT_CS12) ? 12 : 8;
+	const int32_t limit = 1 << (output_bits - 1);
+	const uint64_t cic_gain = (uint64_t)ratio * ratio * ratio;
+	const int log2_gain = (int)ceil(log2((double)cic_gain));
+	const int64_t gain = ((int64_t)1 << (GAIN_BITS + log2_gain)) / cic_gain;
+	const int shift = GAIN_BITS + log2_gain + MIXER_BITS - output_bits;
+	const int kernel_length = CIC_ORDER * (ratio - 1) + 1;
+	uint8_t* out = expected;
+	uint32_t phase = 0;
+	int n, k, stage;
+
+	for(n=0; n<SAMPLE_COUNT; n++) {
+		const int index = phase >> 24;
+		const int32_t s = (int32_t)lround(32767.0 * sin(2 * M_PI * index / 256));
+		const int32_t c = (int32_t)lround(32767.0 * cos(2 * M_PI * index / 256));
+		const int32_t i = input[n*2];
+		const int32_t q = input[n*2+1];
+		mixed_i[n] = (i * c + q * s) >> MIXER_SHIFT;
+		mixed_q[n] = (q * c - i * s) >> MIXER_SHIFT;
+		phase += PHASE_INCREMENT;
+	}
+
+	memset(kernel, 0, sizeof(kernel));
+	kernel[0] = 1;
+	for(stage=0; stage<CIC_ORDER; stage++) {
+		for(k=kernel_length-1; k>=0; k--) {
+			int64_t sum = 0;
+			int j;
+			for(j=0; (j<(int)ratio) && (j<=k); j++) {
+				sum += kernel[k-j];
+			}
+			kernel[k] = sum;
+		}
+	}
+
+	for(n=ratio-1; n<SAMPLE_COUNT; n+=ratio) {
+		int64_t acc_i = 0;
+		int64_t acc_q = 0;
+		for(k=0; (k<kernel_length) && (k<=n); k++) {
+			acc_i += kernel[k] * mixed_i[n-k];
+			acc_q += kernel[k] * mixed_q[n-k];
+		}
+		const int32_t ci = saturate((acc_i * gain) >> shift, limit);
+		const int32_t cq = saturate((acc_q * gain) >> shift, limit);
+		if(format == DECIMATOR_FORMAT_CS16) {
+			*(out++) = ci & 0xff;
+			*(out++) = (ci >> 8) & 0xff;
+			*(out++) = cq & 0xff;
+			*(out++) = (cq >> 8) & 0xff;
+		} else if(format == DECIMATOR_FORMAT_CS12) {
+			const uint32_t packed = (ci & 0xfff) | ((uint32_t)(cq & 0xfff) << 12);
+			*(out++) = packed & 0xff;
+			*(out++) = (packed >> 8) & 0xff;
+			*(out++) = (packed >> 16) & 0xff;
+		} else {
+			*(out++) = ci & 0xff;
+			*(out++) = cq & 0xff;
+		}
+	}
+	return out - expected;
+}
+
+/* Run the decimator over the input in uneven chunks, each decimated in
+ * place as it is on the device. Returns the number of output bytes. */
+static size_t run(const uint32_t ratio, const decimator_format_t format)
+{
+	static uint8_t chunk[sizeof(input)];
+	decimator_t decimator;
+	size_t position = 0;
+	size_t produced = 0;
+	int c = 0;
+
+	if(!decimator_configure(&decimator, ratio, format, PHASE_INCREMENT)) {
+		return 0;
+	}
+	while(position < sizeof(input)) {
+		size_t length = chunk_lengths[c++ % (sizeof(chunk_lengths) / sizeof(chunk_lengths[0]))];
+		if(length > (sizeof(input) - position)) {
+			length = sizeof(input) - position;
+		}
+		memcpy(chunk, &input[position], length);
+		position += length;
+		length = decimator_execute(&decimator, chunk, length);
+		memcpy(&output[produced], chunk, length);
+		produced += length;
+	}
+	return produced;
+}
+
+int main(void)
+{
+	const char* const format_names[] = { "cs8", "cs16", "cs12" };
+	int failures = 0;
+	size_t t, n;
+
+	make_input();
+
+	for(t=0; t<(sizeof(test_cases) / sizeof(test_cases[0])); t++) {
+		const test_case_t* const tc = &test_cases[t];
+		const size_t expected_length = model(tc->ratio, tc->format);
+		const size_t length = run(tc->ratio, tc->format);
+		const char* result = "ok";
+
+		if(length != expected_length) {
+			result = "wrong length";
+		} else if(memcmp(output, expected, length)) {
+			for(n=0; (n<length) && (output[n] == expected[n]); n++);
+			fprintf(stderr, "byte %zu: 0x%02x, model 0x%02x\n",
+				n, output[n], expected[n]);
+			result = "differs from model";
+		} else if(memcmp(output, tc->golden, GOLDEN_LENGTH)) {
+			result = "differs from known good output";
+		}
+		printf("%s ratio %2u: %zu bytes, %s\n", format_names[tc->format],
+			tc->ratio, length, result);
+		if(result[0] != 'o') {
+			failures++;
+		}
+	}
+
+	return failures ? 1 : 0;
+}
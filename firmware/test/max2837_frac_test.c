@@ -0,0 +1,124 @@
+/*
+ * Copyright 2017 Great Scott Gadgets
+ *
+ * This file is part of HackRF.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+
+
+/*
+ * Host test of the MAX2837 fractional divider. max2837_compute_frequency()
+ * works FRAC out from tables; the bit-serial loop it replaced is kept here
+ * as the reference. Every remainder modulo 30 MHz is checked against it,
+ * and both are timed.
+ */
+
+#include "max2837.h"
+
+#include <stdio.h>
+#include <time.h>
+
+#define PLL_STEP 30000000U
+/* Start of a PLL step, so that freq % PLL_STEP runs through every
+ * remainder. */
+#define BASE_FREQ (80 * PLL_STEP)
+
+/* Not called, max2837_compute_frequency() does no I/O. */
+void spi_bus_transfer(spi_bus_t* const bus, void* const data, const size_t count)
+{
+	(void)bus;
+	(void)data;
+	(void)count;
+}
+
+/* The loop max2837_set_frequency() used to have. */
+static __attribute__((noinline)) uint32_t reference_frac(const uint32_t freq)
+{
+	uint32_t div_rem = freq % PLL_STEP;
+	uint32_t div_cmp = PLL_STEP;
+	uint32_t div_frac = 0;
+	int i;
+
+	for( i = 0; i < 20; i++) {
+		div_frac <<= 1;
+		div_cmp >>= 1;
+		if (div_rem > div_cmp) {
+			div_frac |= 0x1;
+			div_rem -= div_cmp;
+		}
+	}
+	return div_frac;
+}
+
+static __attribute__((noinline)) uint32_t table_frac(const uint32_t freq)
+{
+	max2837_freq_config_t cfg;
+
+	max2837_compute_frequency(&cfg, freq);
+	return cfg.div_frac;
+}
+
+static double seconds(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/* Time one pass over every remainder. The sum keeps the calls from
+ * being optimised away. */
+static double benchmark(uint32_t (*frac)(const uint32_t), uint32_t* const sum)
+{
+	const double start = seconds();
+	uint32_t rem;
+
+	*sum = 0;
+	for(rem=0; rem<PLL_STEP; rem++) {
+		*sum += frac(BASE_FREQ + rem);
+	}
+	return seconds() - start;
+}
+
+int main(void)
+{
+	uint32_t mismatches = 0;
+	uint32_t reference_sum, table_sum;
+	double reference_time, table_time;
+	uint32_t rem;
+
+	for(rem=0; rem<PLL_STEP; rem++) {
+		const uint32_t expected = reference_frac(BASE_FREQ + rem);
+		const uint32_t frac = table_frac(BASE_FREQ + rem);
+		if(frac != expected) {
+			if(mismatches < 10) {
+				fprintf(stderr, "remainder %u: FRAC 0x%05x, expected 0x%05x\n",
+					rem, frac, expected);
+			}
+			mismatches++;
+		}
+	}
+	printf("%u remainders checked, %u mismatches\n", PLL_STEP, mismatches);
+
+	reference_time = benchmark(reference_frac, &reference_sum);
+	table_time = benchmark(table_frac, &table_sum);
+	printf("bit-serial loop: %.1f ns per frequency\n", reference_time * 1e9 / PLL_STEP);
+	printf("tables:          %.1f ns per frequency (%.1fx)\n",
+		table_time * 1e9 / PLL_STEP, reference_time / table_time);
+
+	return (mismatches || (reference_sum != table_sum)) ? 1 : 0;
+}
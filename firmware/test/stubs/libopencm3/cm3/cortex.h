@@ -0,0 +1,32 @@
+/*
+ * Copyright 2017 Great Scott Gadgets
+ *
+ * This file is part of HackRF.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+
+
+/* Host stand-in for the libopencm3 header, for firmware unit tests.
+ * There are no interrupts on the host, so these do nothing. */
+
+#ifndef __TEST_STUB_CORTEX_H__
+#define __TEST_STUB_CORTEX_H__
+
+static inline void cm_disable_interrupts(void) {}
+static inline void cm_enable_interrupts(void) {}
+
+#endif/*__TEST_STUB_CORTEX_H__*/
@@ -0,0 +1,42 @@
+/*
+ * Copyright 2017 Great Scott Gadgets
+ *
+ * This file is part of HackRF.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+
+
+/* Host stand-in for the libopencm3 header, for firmware unit tests.
+ * Tests are single threaded, so an exclusive store always succeeds. */
+
+#ifndef __TEST_STUB_SYNC_H__
+#define __TEST_STUB_SYNC_H__
+
+#include <stdint.h>
+
+static inline uint32_t __ldrex(volatile uint32_t* addr)
+{
+	return *addr;
+}
+
+static inline uint32_t __strex(uint32_t val, volatile uint32_t* addr)
+{
+	*addr = val;
+	return 0;
+}
+
+#endif/*__TEST_STUB_SYNC_H__*/
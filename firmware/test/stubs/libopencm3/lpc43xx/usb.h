@@ -0,0 +1,50 @@
+/*
+ * Copyright 2017 Great Scott Gadgets
+ *
+ * This file is part of HackRF.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+
+
+/* Host stand-in for the libopencm3 header, for firmware unit tests. Only
+ * the transfer descriptor layout and its bits are provided. */
+
+#ifndef __TEST_STUB_LPC43XX_USB_H__
+#define __TEST_STUB_LPC43XX_USB_H__
+
+#include <stdint.h>
+
+typedef struct {
+	volatile uint32_t next_dtd_pointer;
+	volatile uint32_t total_bytes;
+	volatile uint32_t buffer_pointer_page[5];
+	volatile uint32_t _reserved;
+} usb_transfer_descriptor_t;
+
+#define USB_TD_NEXT_DTD_POINTER_TERMINATE (1 << 0)
+
+#define USB_TD_DTD_TOKEN_TOTAL_BYTES_SHIFT (16)
+#define USB_TD_DTD_TOKEN_TOTAL_BYTES_MASK (0x7fff << USB_TD_DTD_TOKEN_TOTAL_BYTES_SHIFT)
+#define USB_TD_DTD_TOKEN_TOTAL_BYTES(x) ((x) << USB_TD_DTD_TOKEN_TOTAL_BYTES_SHIFT)
+#define USB_TD_DTD_TOKEN_IOC (1 << 15)
+#define USB_TD_DTD_TOKEN_MULTO(x) ((x) << 10)
+#define USB_TD_DTD_TOKEN_STATUS_ACTIVE (1 << 7)
+#define USB_TD_DTD_TOKEN_STATUS_HALTED (1 << 6)
+#define USB_TD_DTD_TOKEN_STATUS_BUFFER_ERROR (1 << 5)
+#define USB_TD_DTD_TOKEN_STATUS_TRANSACTION_ERROR (1 << 3)
+
+#endif/*__TEST_STUB_LPC43XX_USB_H__*/
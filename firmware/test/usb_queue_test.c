@@ -0,0 +1,475 @@
+/*
+ * Copyright 2017 Great Scott Gadgets
+ *
+ * This file is part of HackRF.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+
+
+/*
+ * Host test of usb_queue.c. The controller is played by the test: it
+ * marks the dTDs handed to usb_endpoint_schedule_wait/append as done or
+ * failed and calls usb_queue_transfer_complete() as the USB interrupt
+ * would. Priming and flushing the endpoint are recorded, not done.
+ * Appending is also timed at a range of queue depths.
+ */
+
+#include "usb_queue.h"
+#include "usb.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <time.h>
+
+#define POOL_SIZE 8
+#define LENGTH 512
+#define BENCH_POOL_SIZE 64
+#define BENCH_ITERATIONS 1000000
+
+static usb_endpoint_t endpoint = {
+	.address = 0x81,
+};
+USB_DEFINE_QUEUE(endpoint, POOL_SIZE);
+
+static usb_endpoint_t bench_endpoint = {
+	.address = 0x82,
+};
+USB_DEFINE_QUEUE(bench_endpoint, BENCH_POOL_SIZE);
+
+static uint8_t buffer[LENGTH];
+
+/* dTDs in the order they were handed to the controller. */
+static usb_transfer_descriptor_t* scheduled[64];
+static unsigned int scheduled_count;
+
+static unsigned int flushes;
+static unsigned int primes;
+static usb_transfer_descriptor_t* primed_td;
+
+typedef struct {
+	unsigned int id;
+	unsigned int bytes;
+} completion_t;
+
+static completion_t completions[64];
+static unsigned int completion_count;
+
+static int failures;
+/* Transfers each completion callback queues behind it. */
+static unsigned int refill;
+
+#define CHECK(condition) do { \
+		if(!(condition)) { \
+			fprintf(stderr, "%s:%d: %s\n", __FILE__, __LINE__, #condition); \
+			failures++; \
+		} \
+	} while(0)
+
+void usb_endpoint_schedule_wait(
+	const usb_endpoint_t* const ep,
+	usb_transfer_descriptor_t* const td
+) {
+	if(ep != &endpoint) {
+		return;
+	}
+	scheduled[scheduled_count++] = td;
+	primes++;
+	primed_td = td;
+}
+
+void usb_endpoint_schedule_append(
+	const usb_endpoint_t* const ep,
+	usb_transfer_descriptor_t* const tail_td,
+	usb_transfer_descriptor_t* const new_td
+) {
+	(void)tail_td;
+	if(ep != &endpoint) {
+		return;
+	}
+	scheduled[scheduled_count++] = new_td;
+}
+
+/* usb.c flushes the endpoint and primes it on first_td, if any. */
+void usb_endpoint_reprime(
+	const usb_endpoint_t* const ep,
+	usb_transfer_descriptor_t* const first_td
+) {
+	if(ep != &endpoint) {
+		return;
+	}
+	flushes++;
+	primed_td = first_td;
+	if(first_td != NULL) {
+		primes++;
+	}
+}
+
+/* The queue's transfers are linked from active to tail, tail is the last
+ * of them and both are NULL together. Returns how many are queued. */
+static unsigned int check_queue(void)
+{
+	usb_transfer_t* t = endpoint_queue.active;
+	usb_transfer_t* last = NULL;
+	unsigned int count = 0;
+
+	while(t != NULL) {
+		last = t;
+		t = t->next;
+		count++;
+		if(count > POOL_SIZE) {
+			break;
+		}
+	}
+	CHECK(count <= POOL_SIZE);
+	CHECK(endpoint_queue.tail == last);
+	return count;
+}
+
+static unsigned int free_count(void)
+{
+	usb_transfer_t* t = endpoint_queue.free_transfers;
+	unsigned int count = 0;
+
+	while((t != NULL) && (count <= POOL_SIZE)) {
+		t = t->next;
+		count++;
+	}
+	return count;
+}
+
+static void schedule(const unsigned int count);
+
+/* Called after the transfer has been popped, so the queue must already be
+ * consistent without it. */
+static void completion(void* user_data, unsigned int bytes)
+{
+	completions[completion_count].id = (unsigned int)(uintptr_t)user_data;
+	completions[completion_count].bytes = bytes;
+	completion_count++;
+	check_queue();
+	schedule(refill);
+}
+
+static void reset(void)
+{
+	usb_queue_flush_endpoint(&endpoint);
+	CHECK(check_queue() == 0);
+	CHECK(free_count() == POOL_SIZE);
+	scheduled_count = 0;
+	completion_count = 0;
+	flushes = 0;
+	primes = 0;
+	primed_td = NULL;
+	refill = 0;
+	usb_queue_errors = (usb_queue_errors_t){ 0 };
+}
+
+/* Queue count transfers, numbered from 1. */
+static void schedule(const unsigned int count)
+{
+	unsigned int i;
+
+	for(i=0; i<count; i++) {
+		CHECK(usb_transfer_schedule(&endpoint, buffer, LENGTH,
+			completion, (void*)(uintptr_t)(scheduled_count + 1)) == 0);
+	}
+}
+
+static void td_done(usb_transfer_descriptor_t* const td)
+{
+	td->total_bytes &= ~(USB_TD_DTD_TOKEN_STATUS_ACTIVE | USB_TD_DTD_TOKEN_TOTAL_BYTES_MASK);
+}
+
+static void td_fail(usb_transfer_descriptor_t* const td, const uint32_t status)
+{
+	td->total_bytes = (td->total_bytes & ~USB_TD_DTD_TOKEN_STATUS_ACTIVE) | status;
+}
+
+static unsigned int error_count(const uint32_t status)
+{
+	switch(status) {
+	case USB_TD_DTD_TOKEN_STATUS_HALTED:
+		return usb_queue_errors.halted;
+	case USB_TD_DTD_TOKEN_STATUS_BUFFER_ERROR:
+		return usb_queue_errors.buffer_errors;
+	default:
+		return usb_queue_errors.transaction_errors;
+	}
+}
+
+/* The first dTD fails. It is returned with 0 bytes and the endpoint is
+ * restarted on the second, which then completes normally. */
+static void test_fail_head(const uint32_t status)
+{
+	reset();
+	schedule(4);
+	CHECK(primes == 1);
+	CHECK(primed_td == scheduled[0]);
+
+	td_fail(scheduled[0], status);
+	usb_queue_transfer_complete(&endpoint);
+	CHECK(error_count(status) == 1);
+	CHECK(completion_count == 1);
+	CHECK(completions[0].id == 1);
+	CHECK(completions[0].bytes == 0);
+	CHECK(flushes == 1);
+	CHECK(primed_td == scheduled[1]);
+	CHECK(check_queue() == 3);
+	CHECK(&endpoint_queue.tail->td == scheduled[3]);
+	CHECK(free_count() == POOL_SIZE - 3);
+
+	td_done(scheduled[1]);
+	usb_queue_transfer_complete(&endpoint);
+	CHECK(completion_count == 2);
+	CHECK(completions[1].id == 2);
+	CHECK(completions[1].bytes == LENGTH);
+	CHECK(flushes == 1);
+	CHECK(check_queue() == 2);
+}
+
+/* The first dTD completes and the second fails, with the rest still
+ * active behind it. Both are returned in order and the endpoint restarts
+ * on the third. */
+static void test_fail_middle(const uint32_t status)
+{
+	reset();
+	schedule(4);
+
+	td_done(scheduled[0]);
+	td_fail(scheduled[1], status);
+	usb_queue_transfer_complete(&endpoint);
+	CHECK(error_count(status) == 1);
+	CHECK(completion_count == 2);
+	CHECK(completions[0].id == 1);
+	CHECK(completions[0].bytes == LENGTH);
+	CHECK(completions[1].id == 2);
+	CHECK(completions[1].bytes == 0);
+	CHECK(flushes == 1);
+	CHECK(primed_td == scheduled[2]);
+	CHECK(check_queue() == 2);
+	CHECK(&endpoint_queue.tail->td == scheduled[3]);
+}
+
+/* The only dTD fails. The endpoint is flushed but not primed and the
+ * queue is left empty, so the next transfer primes it afresh. */
+static void test_fail_last(const uint32_t status)
+{
+	reset();
+	schedule(1);
+
+	td_fail(scheduled[0], status);
+	usb_queue_transfer_complete(&endpoint);
+	CHECK(error_count(status) == 1);
+	CHECK(completion_count == 1);
+	CHECK(completions[0].bytes == 0);
+	CHECK(flushes == 1);
+	CHECK(primed_td == NULL);
+	CHECK(check_queue() == 0);
+	CHECK(free_count() == POOL_SIZE);
+
+	schedule(1);
+	CHECK(primes == 2);
+	CHECK(primed_td == scheduled[1]);
+	CHECK(check_queue() == 1);
+}
+
+/* Transfers complete one at a time, then the rest all at once. The tail
+ * stays on the last transfer until the queue empties. */
+static void test_complete_pops(void)
+{
+	unsigned int i;
+
+	reset();
+	schedule(POOL_SIZE);
+	CHECK(free_count() == 0);
+	CHECK(usb_transfer_schedule(&endpoint, buffer, LENGTH, NULL, NULL) == -1);
+
+	for(i=0; i<(POOL_SIZE / 2); i++) {
+		td_done(scheduled[i]);
+		usb_queue_transfer_complete(&endpoint);
+		CHECK(completion_count == i + 1);
+		CHECK(check_queue() == POOL_SIZE - (i + 1));
+		CHECK(&endpoint_queue.tail->td == scheduled[POOL_SIZE - 1]);
+	}
+	for(; i<POOL_SIZE; i++) {
+		td_done(scheduled[i]);
+	}
+	usb_queue_transfer_complete(&endpoint);
+	CHECK(completion_count == POOL_SIZE);
+	CHECK(check_queue() == 0);
+	CHECK(free_count() == POOL_SIZE);
+	for(i=0; i<POOL_SIZE; i++) {
+		CHECK(completions[i].id == i + 1);
+	}
+
+	/* Empty again, so the next transfer primes the endpoint. */
+	schedule(1);
+	CHECK(primes == 2);
+	CHECK(primed_td == scheduled[POOL_SIZE]);
+}
+
+/* Each callback queues the next transfer, as streaming does, including
+ * from the callback of the last one queued. New transfers go on the tail
+ * and the queue never loses one. */
+static void test_refill_from_callback(void)
+{
+	unsigned int i;
+
+	reset();
+	schedule(2);
+	refill = 1;
+
+	for(i=0; i<6; i++) {
+		td_done(scheduled[i]);
+		usb_queue_transfer_complete(&endpoint);
+		CHECK(check_queue() == 2);
+		CHECK(&endpoint_queue.tail->td == scheduled[scheduled_count - 1]);
+	}
+	CHECK(completion_count == 6);
+	CHECK(scheduled_count == 8);
+
+	/* Both finish before the interrupt: the refill from the first
+	 * callback is appended behind the second. */
+	td_done(scheduled[6]);
+	td_done(scheduled[7]);
+	usb_queue_transfer_complete(&endpoint);
+	CHECK(completion_count == 8);
+	CHECK(check_queue() == 2);
+	CHECK(&endpoint_queue.tail->td == scheduled[9]);
+	CHECK(primes == 1);
+}
+
+/* A flush with transfers outstanding empties the queue, tail included,
+ * and returns them all to the free list. */
+static void test_flush(void)
+{
+	reset();
+	schedule(5);
+	td_done(scheduled[0]);
+	usb_queue_transfer_complete(&endpoint);
+	CHECK(check_queue() == 4);
+
+	usb_queue_flush_endpoint(&endpoint);
+	CHECK(endpoint_queue.active == NULL);
+	CHECK(endpoint_queue.tail == NULL);
+	CHECK(free_count() == POOL_SIZE);
+	CHECK(completion_count == 1);
+
+	schedule(2);
+	CHECK(primes == 2);
+	CHECK(primed_td == scheduled[5]);
+	CHECK(check_queue() == 2);
+	CHECK(&endpoint_queue.tail->td == scheduled[6]);
+}
+
+static double seconds(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/* What endpoint_queue_transfer() did before the queue had a tail pointer:
+ * walk from the head to find the last transfer. */
+static __attribute__((noinline)) usb_transfer_t* walk_to_tail(usb_queue_t* const queue)
+{
+	usb_transfer_t* t = queue->active;
+
+	while((t != NULL) && (t->next != NULL)) {
+		t = t->next;
+	}
+	return t;
+}
+
+/* With depth transfers queued, time appending one and retiring the head,
+ * which keeps the depth steady. Also time the old tail walk at the same
+ * depth. Returns nanoseconds per append. */
+static double bench_append(const unsigned int depth, double* const walk_ns)
+{
+	usb_transfer_t* volatile sink;
+	double start, elapsed;
+	unsigned int i;
+
+	usb_queue_flush_endpoint(&bench_endpoint);
+	for(i=0; i<depth; i++) {
+		usb_transfer_schedule(&bench_endpoint, buffer, LENGTH, NULL, NULL);
+	}
+
+	start = seconds();
+	for(i=0; i<BENCH_ITERATIONS; i++) {
+		usb_transfer_schedule(&bench_endpoint, buffer, LENGTH, NULL, NULL);
+		td_done(&bench_endpoint_queue.active->td);
+		usb_queue_transfer_complete(&bench_endpoint);
+	}
+	elapsed = seconds() - start;
+
+	start = seconds();
+	for(i=0; i<BENCH_ITERATIONS; i++) {
+		sink = walk_to_tail(&bench_endpoint_queue);
+	}
+	(void)sink;
+	*walk_ns = (seconds() - start) * 1e9 / BENCH_ITERATIONS;
+
+	return elapsed * 1e9 / BENCH_ITERATIONS;
+}
+
+int main(void)
+{
+	static const unsigned int depths[] = { 1, 4, 16, BENCH_POOL_SIZE - 1 };
+	static const struct {
+		uint32_t status;
+		const char* name;
+	} statuses[] = {
+		{ USB_TD_DTD_TOKEN_STATUS_HALTED, "halted" },
+		{ USB_TD_DTD_TOKEN_STATUS_BUFFER_ERROR, "buffer error" },
+		{ USB_TD_DTD_TOKEN_STATUS_TRANSACTION_ERROR, "transaction error" },
+	};
+	unsigned int i;
+
+	/* usb_queue.c keeps pointers in 32-bit words, as on the device. */
+	if(((uintptr_t)&endpoint_transfers[POOL_SIZE] > UINT32_MAX)
+			|| ((uintptr_t)&bench_endpoint_transfers[BENCH_POOL_SIZE] > UINT32_MAX)) {
+		fprintf(stderr, "transfer pool above 4 GiB, build without PIE\n");
+		return 1;
+	}
+
+	usb_queue_init(&endpoint_queue);
+	usb_queue_init(&bench_endpoint_queue);
+
+	for(i=0; i<(sizeof(statuses) / sizeof(statuses[0])); i++) {
+		const int before = failures;
+		test_fail_head(statuses[i].status);
+		test_fail_middle(statuses[i].status);
+		test_fail_last(statuses[i].status);
+		printf("%s: %s\n", statuses[i].name, (failures == before) ? "ok" : "FAILED");
+	}
+
+	test_complete_pops();
+	test_refill_from_callback();
+	test_flush();
+	printf("tail after pops, refills and flush: %s\n", failures ? "FAILED" : "ok");
+
+	printf("depth  append+complete  old tail walk\n");
+	for(i=0; i<(sizeof(depths) / sizeof(depths[0])); i++) {
+		double walk_ns;
+		const double append_ns = bench_append(depths[i], &walk_ns);
+		printf("%5u  %11.1f ns  %10.1f ns\n", depths[i], append_ns, walk_ns);
+	}
+
+	return failures ? 1 : 0;
+}
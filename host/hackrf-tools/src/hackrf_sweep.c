@@ -93,10 +93,14 @@ int gettimeofday(struct timeval *tv, void* ignored) {
 #define FREQ_MAX_MHZ (7250) /* 7250 MHz */
 
 #define DEFAULT_SAMPLE_RATE_HZ (20000000) /* 20MHz default sample rate */
-#define DEFAULT_BASEBAND_FILTER_BANDWIDTH (15000000) /* 15MHz default */
+#define MIN_SAMPLE_RATE_HZ (2000000)
+#define MAX_SAMPLE_RATE_HZ (20000000)
+#define DEFAULT_USABLE_PERCENT (75)
+#define DEFAULT_FFT_SIZE (20)
+#define MAX_FFT_SIZE (8184)
 
-#define TUNE_STEP (DEFAULT_SAMPLE_RATE_HZ / FREQ_ONE_MHZ)
-#define OFFSET 7500000
+/* Weight of each new measurement in the per-bin noise floor average */
+#define NOISE_FLOOR_ALPHA (0.05f)
 
 #define BLOCKS_PER_TRANSFER 16
 #define THROWAWAY_BLOCKS 2
@@ -109,6 +113,9 @@ uint32_t num_samples = SAMPLES_PER_BLOCK;
 int num_ranges = 0;
 uint16_t frequencies[MAX_SWEEP_RANGES*2];
 int step_count;
+uint32_t sample_rate_hz = DEFAULT_SAMPLE_RATE_HZ;
+uint32_t step_width; /* Hz */
+uint32_t offset; /* Hz */
 
 static float TimevalDiff(const struct timeval *a, const struct timeval *b) {
    return (a->tv_sec - b->tv_sec) + 1e-6f * (a->tv_usec - b->tv_usec);
@@ -178,10 +185,15 @@ uint32_t antenna_enable;
 
 bool binary_output = false;
 bool ifft_output = false;
+bool detect_output = false;
+uint32_t detect_threshold_db;
 bool one_shot = false;
 volatile bool sweep_started = false;
 
-int fftSize = 20;
+int fftSize = DEFAULT_FFT_SIZE;
+int slice_bins; /* FFT bins in each quarter-step slice */
+int lower_slice; /* first FFT bin of the slice below the tuned frequency */
+int upper_slice; /* first FFT bin of the slice above the tuned frequency */
 double fft_bin_width;
 fftwf_complex *fftwIn = NULL;
 fftwf_complex *fftwOut = NULL;
@@ -192,6 +204,10 @@ fftwf_plan ifftwPlan = NULL;
 uint32_t ifft_idx = 0;
 float* pwr;
 float* window;
+float* excess;
+float* noise_floor = NULL;
+uint32_t noise_floor_bins = 0;
+uint32_t range_first_bin[MAX_SWEEP_RANGES];
 
 float logPower(fftwf_complex in, float scale)
 {
@@ -201,6 +217,79 @@ float logPower(fftwf_complex in, float scale)
 	return log2f(magsq) * 10.0f / log2(10.0f);
 }
 
+/* Index into noise_floor of the first bin of the slice starting at freq */
+static int noise_floor_index(uint64_t freq)
+{
+	int r;
+	uint64_t range_start;
+	uint64_t range_stop;
+
+	for(r = 0; r < num_ranges; r++) {
+		range_start = FREQ_ONE_MHZ * frequencies[2*r];
+		range_stop = FREQ_ONE_MHZ * frequencies[2*r+1];
+		if((freq >= range_start) && (freq < range_stop)) {
+			return range_first_bin[r]
+					+ (int)((freq - range_start) / fft_bin_width + 0.5);
+		}
+	}
+	return -1;
+}
+
+/*
+ * Compare one slice of the spectrum against the running per-bin noise floor
+ * and print one event for each run of adjacent bins that exceed it by the
+ * detection threshold. Bins above the threshold are left out of the noise
+ * floor average so that signals do not raise it.
+ */
+static void detect_events(uint64_t slice_freq, const float* slice_pwr,
+		const char* time_str, long int usec)
+{
+	float* floor;
+	float threshold = (float)detect_threshold_db;
+	int idx, i, start, peak;
+
+	idx = noise_floor_index(slice_freq);
+	if((0 > idx) || ((uint32_t)(idx + slice_bins) > noise_floor_bins)) {
+		return;
+	}
+	floor = &noise_floor[idx];
+
+	/* Seed the noise floor during the first sweep. */
+	if(0 == sweep_count) {
+		memcpy(floor, slice_pwr, slice_bins * sizeof(float));
+		return;
+	}
+
+	for(i = 0; i < slice_bins; i++) {
+		excess[i] = slice_pwr[i] - floor[i];
+	}
+	for(i = 0; i < slice_bins; i++) {
+		floor[i] += (excess[i] < threshold) ? NOISE_FLOOR_ALPHA * excess[i] : 0.0f;
+	}
+
+	for(i = 0; i < slice_bins; i++) {
+		if(excess[i] < threshold) {
+			continue;
+		}
+		start = i;
+		peak = i;
+		while((i < slice_bins) && (excess[i] >= threshold)) {
+			if(slice_pwr[i] > slice_pwr[peak]) {
+				peak = i;
+			}
+			i++;
+		}
+		fprintf(fd, "%s.%06ld, %" PRIu64 ", %" PRIu64 ", %" PRIu64 ", %.2f, %.2f\n",
+				time_str,
+				usec,
+				(uint64_t)(slice_freq + start * fft_bin_width),
+				(uint64_t)(slice_freq + i * fft_bin_width),
+				(uint64_t)(slice_freq + (peak + 0.5) * fft_bin_width),
+				slice_pwr[peak],
+				excess[peak]);
+	}
+}
+
 int rx_callback(hackrf_transfer* transfer) {
 	int8_t* buf;
 	uint8_t* ubuf;
@@ -219,7 +308,7 @@ int rx_callback(hackrf_transfer* transfer) {
 	gettimeofday(&usb_transfer_time, NULL);
 	byte_count += transfer->valid_length;
 	buf = (int8_t*) transfer->buffer;
-	ifft_bins = fftSize * step_count;
+	ifft_bins = 4 * slice_bins * step_count;
 	for(j=0; j<BLOCKS_PER_TRANSFER; j++) {
 		ubuf = (uint8_t*) buf;
 		if(ubuf[0] == 0x7F && ubuf[1] == 0x7F) {
@@ -250,7 +339,7 @@ int rx_callback(hackrf_transfer* transfer) {
 			time_stamp = usb_transfer_time;
 			time_stamp.tv_usec +=
 					(uint64_t)(num_samples + THROWAWAY_BLOCKS * SAMPLES_PER_BLOCK)
-					* j * FREQ_ONE_MHZ / DEFAULT_SAMPLE_RATE_HZ;
+					* j * FREQ_ONE_MHZ / sample_rate_hz;
 			if(999999 < time_stamp.tv_usec) {
 				time_stamp.tv_sec += time_stamp.tv_usec / 1000000;
 				time_stamp.tv_usec = time_stamp.tv_usec % 1000000;
@@ -280,35 +369,43 @@ int rx_callback(hackrf_transfer* transfer) {
 		}
 		if(binary_output) {
 			record_length = 2 * sizeof(band_edge)
-					+ (fftSize/4) * sizeof(float);
+					+ slice_bins * sizeof(float);
 
 			fwrite(&record_length, sizeof(record_length), 1, fd);
 			band_edge = frequency;
 			fwrite(&band_edge, sizeof(band_edge), 1, fd);
-			band_edge = frequency + DEFAULT_SAMPLE_RATE_HZ / 4;
+			band_edge = frequency + step_width / 4;
 			fwrite(&band_edge, sizeof(band_edge), 1, fd);
-			fwrite(&pwr[1+(fftSize*5)/8], sizeof(float), fftSize/4, fd);
+			fwrite(&pwr[lower_slice], sizeof(float), slice_bins, fd);
 
 			fwrite(&record_length, sizeof(record_length), 1, fd);
-			band_edge = frequency + DEFAULT_SAMPLE_RATE_HZ / 2;
+			band_edge = frequency + step_width / 2;
 			fwrite(&band_edge, sizeof(band_edge), 1, fd);
-			band_edge = frequency + (DEFAULT_SAMPLE_RATE_HZ * 3) / 4;
+			band_edge = frequency + (step_width * 3) / 4;
 			fwrite(&band_edge, sizeof(band_edge), 1, fd);
-			fwrite(&pwr[1+fftSize/8], sizeof(float), fftSize/4, fd);
+			fwrite(&pwr[upper_slice], sizeof(float), slice_bins, fd);
 		} else if(ifft_output) {
 			ifft_idx = round((frequency - (uint64_t)(FREQ_ONE_MHZ*frequencies[0]))
 					/ fft_bin_width);
 			ifft_idx = (ifft_idx + ifft_bins/2) % ifft_bins;
-			for(i = 0; (fftSize / 4) > i; i++) {
-				ifftwIn[ifft_idx + i][0] = fftwOut[i + 1 + (fftSize*5)/8][0];
-				ifftwIn[ifft_idx + i][1] = fftwOut[i + 1 + (fftSize*5)/8][1];
+			for(i = 0; slice_bins > i; i++) {
+				ifftwIn[ifft_idx + i][0] = fftwOut[i + lower_slice][0];
+				ifftwIn[ifft_idx + i][1] = fftwOut[i + lower_slice][1];
 			}
-			ifft_idx += fftSize / 2;
+			ifft_idx += 2 * slice_bins;
 			ifft_idx %= ifft_bins;
-			for(i = 0; (fftSize / 4) > i; i++) {
-				ifftwIn[ifft_idx + i][0] = fftwOut[i + 1 + (fftSize/8)][0];
-				ifftwIn[ifft_idx + i][1] = fftwOut[i + 1 + (fftSize/8)][1];
+			for(i = 0; slice_bins > i; i++) {
+				ifftwIn[ifft_idx + i][0] = fftwOut[i + upper_slice][0];
+				ifftwIn[ifft_idx + i][1] = fftwOut[i + upper_slice][1];
 			}
+		} else if(detect_output) {
+			time_t time_stamp_seconds = time_stamp.tv_sec;
+			fft_time = localtime(&time_stamp_seconds);
+			strftime(time_str, 50, "%Y-%m-%d, %H:%M:%S", fft_time);
+			detect_events(frequency, &pwr[lower_slice], time_str,
+					(long int)time_stamp.tv_usec);
+			detect_events(frequency + step_width / 2, &pwr[upper_slice], time_str,
+					(long int)time_stamp.tv_usec);
 		} else {
 			time_t time_stamp_seconds = time_stamp.tv_sec;
 			fft_time = localtime(&time_stamp_seconds);
@@ -317,22 +414,22 @@ int rx_callback(hackrf_transfer* transfer) {
 					time_str,
 					(long int)time_stamp.tv_usec,
 					(uint64_t)(frequency),
-					(uint64_t)(frequency+DEFAULT_SAMPLE_RATE_HZ/4),
+					(uint64_t)(frequency+step_width/4),
 					fft_bin_width,
 					fftSize);
-			for(i = 0; (fftSize / 4) > i; i++) {
-				fprintf(fd, ", %.2f", pwr[i + 1 + (fftSize*5)/8]);
+			for(i = 0; slice_bins > i; i++) {
+				fprintf(fd, ", %.2f", pwr[i + lower_slice]);
 			}
 			fprintf(fd, "\n");
 			fprintf(fd, "%s.%06ld, %" PRIu64 ", %" PRIu64 ", %.2f, %u",
 					time_str,
 					(long int)time_stamp.tv_usec,
-					(uint64_t)(frequency+(DEFAULT_SAMPLE_RATE_HZ/2)),
-					(uint64_t)(frequency+((DEFAULT_SAMPLE_RATE_HZ*3)/4)),
+					(uint64_t)(frequency+(step_width/2)),
+					(uint64_t)(frequency+((step_width*3)/4)),
 					fft_bin_width,
 					fftSize);
-			for(i = 0; (fftSize / 4) > i; i++) {
-				fprintf(fd, ", %.2f", pwr[i + 1 + (fftSize/8)]);
+			for(i = 0; slice_bins > i; i++) {
+				fprintf(fd, ", %.2f", pwr[i + upper_slice]);
 			}
 			fprintf(fd, "\n");
 		}
@@ -351,13 +448,19 @@ static void usage() {
 	fprintf(stderr, "\t[-g gain_db] # RX VGA (baseband) gain, 0-62dB, 2dB steps\n");
 	fprintf(stderr, "\t[-n num_samples] # Number of samples per frequency, 8192-4294967296\n");
 	fprintf(stderr, "\t[-w bin_width] # FFT bin width (frequency resolution) in Hz\n");
+	fprintf(stderr, "\t[-s sample_rate_hz] # Sample rate in Hz, 2000000-20000000, default 20000000\n");
+	fprintf(stderr, "\t[-u usable_percent] # Percentage of each capture used, 1-100, default 75\n");
+	fprintf(stderr, "\t[-S step_width] # Tuning step width in Hz, overrides -u\n");
 	fprintf(stderr, "\t[-1] # one shot mode\n");
 	fprintf(stderr, "\t[-B] # binary output\n");
 	fprintf(stderr, "\t[-I] # binary inverse FFT output\n");
+	fprintf(stderr, "\t[-t threshold_db] # only output signals this far above the noise floor, not with -1\n");
 	fprintf(stderr, "\t-r filename # output file\n");
 	fprintf(stderr, "\n");
 	fprintf(stderr, "Output fields:\n");
 	fprintf(stderr, "\tdate, time, hz_low, hz_high, hz_bin_width, num_samples, dB, dB, . . .\n");
+	fprintf(stderr, "Output fields with -t:\n");
+	fprintf(stderr, "\tdate, time, hz_low, hz_high, hz_peak, peak_dB, dB_above_noise_floor\n");
 }
 
 static hackrf_device* device = NULL;
@@ -390,10 +493,17 @@ int main(int argc, char** argv) {
 	unsigned int lna_gain=16, vga_gain=20;
 	uint32_t freq_min = 0;
 	uint32_t freq_max = 6000;
-	uint32_t requested_fft_bin_width;
+	uint32_t requested_fft_bin_width = 0;
+	uint32_t usable_percent = DEFAULT_USABLE_PERCENT;
+	uint32_t requested_step_width = 0;
+	double target_step;
+	int fallback_fft_size = 0;
+	int n, b;
+	uint32_t baseband_filter_bw_hz;
+	uint64_t span;
 
 
-	while( (opt = getopt(argc, argv, "a:f:p:l:g:d:n:w:1BIr:h?")) != EOF ) {
+	while( (opt = getopt(argc, argv, "a:f:p:l:g:d:n:w:s:u:S:1BIt:r:h?")) != EOF ) {
 		result = HACKRF_SUCCESS;
 		switch( opt ) 
 		{
@@ -452,7 +562,18 @@ int main(int argc, char** argv) {
 
 		case 'w':
 			result = parse_u32(optarg, &requested_fft_bin_width);
-			fftSize = DEFAULT_SAMPLE_RATE_HZ / requested_fft_bin_width;
+			break;
+
+		case 's':
+			result = parse_u32(optarg, &sample_rate_hz);
+			break;
+
+		case 'u':
+			result = parse_u32(optarg, &usable_percent);
+			break;
+
+		case 'S':
+			result = parse_u32(optarg, &requested_step_width);
 			break;
 
 		case '1':
@@ -467,6 +588,11 @@ int main(int argc, char** argv) {
 			ifft_output = true;
 			break;
 
+		case 't':
+			detect_output = true;
+			result = parse_u32(optarg, &detect_threshold_db);
+			break;
+
 		case 'r':
 			path = optarg;
 			break;
@@ -532,36 +658,116 @@ int main(int argc, char** argv) {
 		return EXIT_FAILURE;
 	}
 
+	if(detect_output && (binary_output || ifft_output)) {
+		fprintf(stderr, "argument error: detection output (-t) can not be combined with -B or -I.\n");
+		return EXIT_FAILURE;
+	}
+
+	if(detect_output && one_shot) {
+		fprintf(stderr, "argument error: detection output (-t) can not be combined with one shot mode (-1), the first sweep only learns the noise floor.\n");
+		usage();
+		return EXIT_FAILURE;
+	}
+
 	if(ifft_output && (1 < num_ranges)) {
 		fprintf(stderr, "argument error: only one frequency range is supported in IFFT output (-I) mode.\n");
 		return EXIT_FAILURE;
 	}
 
+	if((MIN_SAMPLE_RATE_HZ > sample_rate_hz) || (MAX_SAMPLE_RATE_HZ < sample_rate_hz)) {
+		fprintf(stderr,
+				"argument error: sample rate (-s) must be between %u and %u Hz\n",
+				MIN_SAMPLE_RATE_HZ, MAX_SAMPLE_RATE_HZ);
+		return EXIT_FAILURE;
+	}
+
+	if((1 > usable_percent) || (100 < usable_percent)) {
+		fprintf(stderr,
+				"argument error: usable percentage (-u) must be between 1 and 100\n");
+		return EXIT_FAILURE;
+	}
+
+	if(requested_fft_bin_width) {
+		fftSize = sample_rate_hz / requested_fft_bin_width;
+	}
+
 	if(4 > fftSize) {
 		fprintf(stderr,
 				"argument error: FFT bin width (-w) must be no more than one quarter the sample rate\n");
 		return EXIT_FAILURE;
 	}
 
-	if(8184 < fftSize) {
+	if(MAX_FFT_SIZE < fftSize) {
 		fprintf(stderr,
-				"argument error: FFT bin width (-w) too small, resulted in more than 8184 FFT bins\n");
+				"argument error: FFT bin width (-w) too small, resulted in more than %u FFT bins\n",
+				MAX_FFT_SIZE);
 		return EXIT_FAILURE;
 	}
 
-	/* In interleaved mode, the FFT bin selection works best if the total
-	 * number of FFT bins is equal to an odd multiple of four.
-	 * (e.g. 4, 12, 20, 28, 36, . . .)
+	/*
+	 * In interleaved mode each tuning step is captured twice, a quarter
+	 * step apart, and two quarter-step slices are kept from each capture:
+	 * one from 3/8 to 1/8 of a step below the tuned frequency and one from
+	 * 1/8 to 3/8 of a step above it. The step is 4/3 of the usable part of
+	 * the sample rate.
+	 *
+	 * Slices are an odd number of FFT bins wide so that their edges fall
+	 * on bin boundaries, and the step is a whole number of bins so that
+	 * every hop lands on the same bin grid. Look for the smallest FFT size
+	 * no smaller than requested that also makes the step a whole number of
+	 * Hz.
 	 */
-	while((fftSize + 4) % 8) {
-		fftSize++;
+	if(requested_step_width) {
+		target_step = requested_step_width;
+	} else {
+		target_step = (4.0 * usable_percent * sample_rate_hz) / 300.0;
+	}
+	for(n = fftSize; MAX_FFT_SIZE >= n; n++) {
+		b = (int)(target_step * n / (4.0 * sample_rate_hz) + 1e-6);
+		if(0 == (b % 2)) {
+			b--;
+		}
+		if(1 > b) {
+			continue;
+		}
+		if(0 == fallback_fft_size) {
+			fallback_fft_size = n;
+		}
+		if(0 == (((uint64_t)sample_rate_hz * b) % n)) {
+			break;
+		}
+	}
+	if(MAX_FFT_SIZE < n) {
+		if(0 == fallback_fft_size) {
+			fprintf(stderr,
+					"argument error: step width (-S) too small for the sample rate\n");
+			return EXIT_FAILURE;
+		}
+		n = fallback_fft_size;
+		b = (int)(target_step * n / (4.0 * sample_rate_hz) + 1e-6);
+		if(0 == (b % 2)) {
+			b--;
+		}
+	}
+	if(3 * b > n) {
+		fprintf(stderr,
+				"argument error: step width (-S) must be no more than 4/3 of the sample rate\n");
+		return EXIT_FAILURE;
 	}
 
-	fft_bin_width = (double)DEFAULT_SAMPLE_RATE_HZ / fftSize;
+	fftSize = n;
+	slice_bins = b;
+	upper_slice = (slice_bins + 1) / 2;
+	lower_slice = fftSize - (3 * slice_bins - 1) / 2;
+	step_width = (uint32_t)((4ULL * sample_rate_hz * slice_bins) / fftSize);
+	offset = (step_width * 3) / 8;
+
+	fft_bin_width = (double)sample_rate_hz / fftSize;
 	fftwIn = (fftwf_complex*)fftwf_malloc(sizeof(fftwf_complex) * fftSize);
 	fftwOut = (fftwf_complex*)fftwf_malloc(sizeof(fftwf_complex) * fftSize);
 	fftwPlan = fftwf_plan_dft_1d(fftSize, fftwIn, fftwOut, FFTW_FORWARD, FFTW_MEASURE);
 	pwr = (float*)fftwf_malloc(sizeof(float) * fftSize);
+	excess = (float*)fftwf_malloc(sizeof(float) * fftSize);
 	window = (float*)fftwf_malloc(sizeof(float) * fftSize);
 	for (i = 0; i < fftSize; i++) {
 		window[i] = 0.5f * (1.0f - cos(2 * M_PI * i / (fftSize - 1)));
@@ -610,8 +816,8 @@ int main(int argc, char** argv) {
 	signal(SIGABRT, &sigint_callback_handler);
 #endif
 	fprintf(stderr, "call hackrf_sample_rate_set(%.03f MHz)\n",
-		   ((float)DEFAULT_SAMPLE_RATE_HZ/(float)FREQ_ONE_MHZ));
-	result = hackrf_set_sample_rate_manual(device, DEFAULT_SAMPLE_RATE_HZ, 1);
+		   ((float)sample_rate_hz/(float)FREQ_ONE_MHZ));
+	result = hackrf_set_sample_rate_manual(device, sample_rate_hz, 1);
 	if( result != HACKRF_SUCCESS ) {
 		fprintf(stderr, "hackrf_sample_rate_set() failed: %s (%d)\n",
 			   hackrf_error_name(result), result);
@@ -619,9 +825,10 @@ int main(int argc, char** argv) {
 		return EXIT_FAILURE;
 	}
 
+	baseband_filter_bw_hz = hackrf_compute_baseband_filter_bw(sample_rate_hz * 3 / 4);
 	fprintf(stderr, "call hackrf_baseband_filter_bandwidth_set(%.03f MHz)\n",
-			((float)DEFAULT_BASEBAND_FILTER_BANDWIDTH/(float)FREQ_ONE_MHZ));
-	result = hackrf_set_baseband_filter_bandwidth(device, DEFAULT_BASEBAND_FILTER_BANDWIDTH);
+			((float)baseband_filter_bw_hz/(float)FREQ_ONE_MHZ));
+	result = hackrf_set_baseband_filter_bandwidth(device, baseband_filter_bw_hz);
 	if( result != HACKRF_SUCCESS ) {
 		fprintf(stderr, "hackrf_baseband_filter_bandwidth_set() failed: %s (%d)\n",
 			   hackrf_error_name(result), result);
@@ -632,23 +839,41 @@ int main(int argc, char** argv) {
 	result = hackrf_set_vga_gain(device, vga_gain);
 	result |= hackrf_set_lna_gain(device, lna_gain);
 
+	fprintf(stderr, "Step width %u Hz, %d FFT bins of %.2f Hz\n",
+			step_width, fftSize, fft_bin_width);
+
 	/*
 	 * For each range, plan a whole number of tuning steps of a certain
 	 * bandwidth. Increase high end of range if necessary to accommodate a
 	 * whole number of steps, minimum 1.
 	 */
 	for(i = 0; i < num_ranges; i++) {
-		step_count = 1 + (frequencies[2*i+1] - frequencies[2*i] - 1)
-				/ TUNE_STEP;
-		frequencies[2*i+1] = frequencies[2*i] + step_count * TUNE_STEP;
+		span = (uint64_t)(frequencies[2*i+1] - frequencies[2*i]) * FREQ_ONE_MHZ;
+		step_count = 1 + (span - 1) / step_width;
+		span = step_count * (uint64_t)step_width;
+		frequencies[2*i+1] = frequencies[2*i]
+				+ (span + FREQ_ONE_MHZ - 1) / FREQ_ONE_MHZ;
+		/* The firmware moves on to the next range once the following
+		 * step would reach the (whole MHz) upper edge, which may leave
+		 * room for an extra step when the step is not a whole number of
+		 * MHz. */
+		span = (uint64_t)(frequencies[2*i+1] - frequencies[2*i]) * FREQ_ONE_MHZ;
+		step_count = (4 * span - step_width + 4 * (uint64_t)step_width - 1)
+				/ (4 * (uint64_t)step_width);
 		fprintf(stderr, "Sweeping from %u MHz to %u MHz\n",
 				frequencies[2*i], frequencies[2*i+1]);
+		range_first_bin[i] = noise_floor_bins;
+		noise_floor_bins += 4 * slice_bins * step_count;
+	}
+
+	if(detect_output) {
+		noise_floor = (float*)fftwf_malloc(sizeof(float) * noise_floor_bins);
 	}
 
 	if(ifft_output) {
-		ifftwIn = (fftwf_complex*)fftwf_malloc(sizeof(fftwf_complex) * fftSize * step_count);
-		ifftwOut = (fftwf_complex*)fftwf_malloc(sizeof(fftwf_complex) * fftSize * step_count);
-		ifftwPlan = fftwf_plan_dft_1d(fftSize * step_count, ifftwIn, ifftwOut, FFTW_BACKWARD, FFTW_MEASURE);
+		ifftwIn = (fftwf_complex*)fftwf_malloc(sizeof(fftwf_complex) * 4 * slice_bins * step_count);
+		ifftwOut = (fftwf_complex*)fftwf_malloc(sizeof(fftwf_complex) * 4 * slice_bins * step_count);
+		ifftwPlan = fftwf_plan_dft_1d(4 * slice_bins * step_count, ifftwIn, ifftwOut, FFTW_BACKWARD, FFTW_MEASURE);
 	}
 
 	result |= hackrf_start_rx(device, rx_callback, NULL);
@@ -659,7 +884,7 @@ int main(int argc, char** argv) {
 	}
 
 	result = hackrf_init_sweep(device, frequencies, num_ranges, num_samples * 2,
-			TUNE_STEP * FREQ_ONE_MHZ, OFFSET, INTERLEAVED);
+			step_width, offset, INTERLEAVED);
 	if( result != HACKRF_SUCCESS ) {
 		fprintf(stderr, "hackrf_init_sweep() failed: %s (%d)\n",
 			   hackrf_error_name(result), result);
@@ -724,6 +949,16 @@ int main(int argc, char** argv) {
 			sweep_count, time_diff, sweep_rate);
 
 	if(device != NULL) {
+		hackrf_sweep_stats stats;
+		result = hackrf_get_sweep_stats(device, &stats);
+		if((result == HACKRF_SUCCESS) && (stats.hops > 0)) {
+			fprintf(stderr, "Retune time: last %.1f us, max %.1f us, "
+					"%u lock timeouts, %u blocks discarded\n",
+					stats.last_retune_samples * 1e6 / sample_rate_hz,
+					stats.max_retune_samples * 1e6 / sample_rate_hz,
+					stats.lock_timeouts, stats.discarded_blocks);
+		}
+
 		result = hackrf_stop_rx(device);
 		if(result != HACKRF_SUCCESS) {
 			fprintf(stderr, "hackrf_stop_rx() failed: %s (%d)\n",
@@ -752,6 +987,8 @@ int main(int argc, char** argv) {
 	fftwf_free(fftwIn);
 	fftwf_free(fftwOut);
 	fftwf_free(pwr);
+	fftwf_free(excess);
+	fftwf_free(noise_floor);
 	fftwf_free(window);
 	fftwf_free(ifftwIn);
 	fftwf_free(ifftwOut);
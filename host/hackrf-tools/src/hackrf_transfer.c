@@ -546,6 +546,10 @@ int main(int argc, char** argv) {
 	int exit_code = EXIT_SUCCESS;
 	struct timeval t_end;
 	float time_diff;
+	hackrf_cpu_idle cpu_idle_last, cpu_idle_now;
+	bool cpu_idle_available;
+	hackrf_buffer_stats buffer_stats;
+	uint32_t buffer_overruns_last = 0;
 	unsigned int lna_gain=8, vga_gain=20, txvga_gain=0;
   
 	while( (opt = getopt(argc, argv, "H:wr:t:f:i:o:m:a:p:s:n:b:l:g:x:c:d:C:RS:h?")) != EOF )
@@ -1037,6 +1041,8 @@ int main(int argc, char** argv) {
 	gettimeofday(&t_start, NULL);
 	gettimeofday(&time_start, NULL);
 
+	cpu_idle_available = (hackrf_get_cpu_idle(device, &cpu_idle_last) == HACKRF_SUCCESS);
+
 	fprintf(stderr, "Stop with Ctrl-C\n");
 	while( (hackrf_is_streaming(device) == HACKRF_TRUE) &&
 			(do_exit == false) ) 
@@ -1081,8 +1087,23 @@ int main(int argc, char** argv) {
 			if (byte_count_now == 0 && hw_sync == true && hw_sync_enable != 0) {
 			    fprintf(stderr, "Waiting for sync...\n");
 			} else {
-			    fprintf(stderr, "%4.1f MiB / %5.3f sec = %4.1f MiB/second\n",
+			    fprintf(stderr, "%4.1f MiB / %5.3f sec = %4.1f MiB/second",
 					    (byte_count_now / 1e6f), time_difference, (rate / 1e6f) );
+			    if (cpu_idle_available
+			        && hackrf_get_cpu_idle(device, &cpu_idle_now) == HACKRF_SUCCESS
+			        && cpu_idle_now.total_cycles > cpu_idle_last.total_cycles) {
+					fprintf(stderr, ", CPU idle %4.1f%%",
+						100.0 * (cpu_idle_now.idle_cycles - cpu_idle_last.idle_cycles)
+						/ (cpu_idle_now.total_cycles - cpu_idle_last.total_cycles));
+					cpu_idle_last = cpu_idle_now;
+			    }
+			    if (hackrf_get_buffer_stats(device, &buffer_stats) == HACKRF_SUCCESS
+			        && buffer_stats.overruns != buffer_overruns_last) {
+					fprintf(stderr, ", %u buffer overruns",
+						buffer_stats.overruns - buffer_overruns_last);
+					buffer_overruns_last = buffer_stats.overruns;
+			    }
+			    fprintf(stderr, "\n");
 			}
 
 			time_start = time_now;
@@ -74,6 +74,8 @@ typedef int bool;
 #define USB_CONFIG_STANDARD 0x1
 #define TRANSFER_COUNT 4
 #define TRANSFER_BUFFER_SIZE 262144
+#define SWEEP_HOP_ENTRY_SIZE 10
+#define SWEEP_HOPS_PER_CHUNK 25
 
 #define USB_API_REQUIRED(device, version)                           \
     {                                                               \
@@ -125,6 +127,23 @@ typedef enum {
     HACKRF_VENDOR_REQUEST_CLKOUT_ENABLE                 = 32,
     HACKRF_VENDOR_REQUEST_SPIFLASH_STATUS               = 33,
     HACKRF_VENDOR_REQUEST_SPIFLASH_CLEAR_STATUS         = 34,
+    HACKRF_VENDOR_REQUEST_INIT_SWEEP_HOPS               = 35,
+    HACKRF_VENDOR_REQUEST_GET_SWEEP_STATS               = 36,
+    HACKRF_VENDOR_REQUEST_GET_CPU_IDLE                  = 37,
+    HACKRF_VENDOR_REQUEST_GET_BUFFER_STATS              = 38,
+    HACKRF_VENDOR_REQUEST_SET_DECIMATION                = 39,
+    HACKRF_VENDOR_REQUEST_GET_SAMPLE_FORMATS            = 40,
+    HACKRF_VENDOR_REQUEST_GET_USB_ERRORS                = 41,
+    HACKRF_VENDOR_REQUEST_SWITCH_DIRECTION              = 42,
+    HACKRF_VENDOR_REQUEST_GET_TUNING_STATS              = 43,
+    HACKRF_VENDOR_REQUEST_SAMPLE_RATE_IN_STREAM         = 44,
+    HACKRF_VENDOR_REQUEST_GET_RATE_CHANGE               = 45,
+    HACKRF_VENDOR_REQUEST_SAMPLE_RATE_MULTISYNTH        = 46,
+    HACKRF_VENDOR_REQUEST_APPLY_CONFIG                  = 47,
+    HACKRF_VENDOR_REQUEST_GET_CONFIG_RESULT             = 48,
+    HACKRF_VENDOR_REQUEST_SCHEDULE_COMMAND              = 49,
+    HACKRF_VENDOR_REQUEST_CLEAR_SCHEDULE                = 50,
+    HACKRF_VENDOR_REQUEST_GET_SCHEDULE_STATS            = 51,
 } hackrf_vendor_request;
 
 /// @private
@@ -134,6 +153,7 @@ typedef enum {
     HACKRF_TRANSCEIVER_MODE_TRANSMIT = 2,
     HACKRF_TRANSCEIVER_MODE_SS = 3,
     TRANSCEIVER_MODE_CPLD_UPDATE = 4,
+    HACKRF_TRANSCEIVER_MODE_TX_ECHO = 5,
 } hackrf_transceiver_mode;
 
 /// @private
@@ -147,12 +167,15 @@ struct hackrf_device {
     libusb_device_handle* usb_device;
     struct libusb_transfer** transfers;
     hackrf_sample_block_cb_fn callback;
+    hackrf_sample_block_cb_fn tx_callback; // OUT transfers when both endpoints stream
     volatile bool transfer_thread_started; // volatile shared between threads (read only)
     pthread_t transfer_thread;
     volatile bool streaming; // volatile shared between threads (read only)
     void* rx_ctx;
     void* tx_ctx;
     unsigned char buffer[TRANSFER_COUNT * TRANSFER_BUFFER_SIZE];
+    double sample_rate_request; // last rate solved by hackrf_set_sample_rate_exact()
+    hackrf_sample_rate_solution sample_rate_solution;
 };
 
 /// @private
@@ -318,6 +341,40 @@ prepare_transfers(hackrf_device*        device,
     }
 }
 
+// TX echo and TDD streaming use the first half of the transfers for the OUT
+// endpoint and the second half for the IN endpoint.
+static enum hackrf_error
+prepare_duplex_transfers(hackrf_device*        device,
+                         libusb_transfer_cb_fn callback) {
+    // FIXME: what if `device == NULL`?
+
+    if(device->transfers != NULL) {
+        {
+            uint32_t i;
+            for(i = 0; i < TRANSFER_COUNT; i++) {
+                if(i < (TRANSFER_COUNT / 2)) {
+                    device->transfers[i]->endpoint = LIBUSB_ENDPOINT_OUT | 2;
+                } else {
+                    device->transfers[i]->endpoint = LIBUSB_ENDPOINT_IN | 1;
+                }
+                device->transfers[i]->callback = callback;
+
+                enum libusb_error error
+                    = libusb_submit_transfer(device->transfers[i]);
+                if(error != 0) {
+                    last_libusb_error = error;
+                    return HACKRF_ERROR_LIBUSB;
+                }
+            }
+        }
+        return HACKRF_SUCCESS;
+    } else {
+        // This shouldn't happen.
+        // FIXME: if that's true, maybe this should be `assert(false)`?
+        return HACKRF_ERROR_OTHER;
+    }
+}
+
 static enum hackrf_error
 detach_kernel_drivers(libusb_device_handle* usb_device_handle) {
     // FIXME: what if `usb_device_handle == NULL`?
@@ -658,8 +715,10 @@ hackrf_open_setup(libusb_device_handle* usb_device,
     lib_device->usb_device              = usb_device;
     lib_device->transfers               = NULL;
     lib_device->callback                = NULL;
+    lib_device->tx_callback             = NULL;
     lib_device->transfer_thread_started = false;
     lib_device->streaming               = false;
+    lib_device->sample_rate_request     = 0.0;
 
     do_exit = false;
 
@@ -1366,17 +1425,12 @@ hackrf_set_sample_rate_manual(hackrf_device* device,
     }
 }
 
-// For anti-aliasing, the baseband filter bandwidth is automatically set to the
-// widest available setting that is no more than 75% of the sample rate.  This
-// happens every time the sample rate is set. If you want to override the
-// baseband filter selection, you must do so after setting the sample rate.
-enum hackrf_error ADDCALL
-hackrf_set_sample_rate(hackrf_device* device,
-                       double         freq) {
-    // FIXME: what if `device == NULL`?
-
+// Find a freq_hz / divider pair, divider below 32, close to `freq`.
+static void
+compute_fracrate(double    freq,
+                 uint32_t* freq_hz,
+                 uint32_t* divider) {
     const int MAX_N = 32;
-    uint32_t freq_hz, divider;
     double freq_frac = 1.0 + freq - (int)freq;
     uint64_t a, m;
 
@@ -1409,12 +1463,422 @@ hackrf_set_sample_rate(hackrf_device* device,
         i = 1;
     }
 
-    freq_hz = (uint32_t)(freq * i + 0.5);
-    divider = i;
+    *freq_hz = (uint32_t)(freq * i + 0.5);
+    *divider = i;
+}
+
+// For anti-aliasing, the baseband filter bandwidth is automatically set to the
+// widest available setting that is no more than 75% of the sample rate.  This
+// happens every time the sample rate is set. If you want to override the
+// baseband filter selection, you must do so after setting the sample rate.
+enum hackrf_error ADDCALL
+hackrf_set_sample_rate(hackrf_device* device,
+                       double         freq) {
+    // FIXME: what if `device == NULL`?
+
+    uint32_t freq_hz, divider;
+    compute_fracrate(freq, &freq_hz, &divider);
 
     return hackrf_set_sample_rate_manual(device, freq_hz, divider);
 }
 
+/// @private
+typedef struct {
+    uint32_t freq_hz;
+    uint32_t divider;
+    uint32_t bandwidth_hz;
+} set_rate_in_stream_params_t;
+
+enum hackrf_error ADDCALL
+hackrf_set_sample_rate_in_stream(hackrf_device*      device,
+                                 double              freq,
+                                 hackrf_rate_change* change) {
+    // FIXME: what if `device == NULL`?
+
+    USB_API_REQUIRED(device, 0x0104);
+
+    uint32_t freq_hz, divider;
+    compute_fracrate(freq, &freq_hz, &divider);
+
+    set_rate_in_stream_params_t params;
+    params.freq_hz      = TO_LE32(freq_hz);
+    params.divider      = TO_LE32(divider);
+    params.bandwidth_hz = TO_LE32(hackrf_compute_baseband_filter_bw((uint32_t)(0.75*freq_hz/divider)));
+
+    uint8_t length = sizeof(set_rate_in_stream_params_t);
+
+    enum libusb_error result = libusb_control_transfer(
+        device->usb_device,
+        LIBUSB_ENDPOINT_OUT | LIBUSB_REQUEST_TYPE_VENDOR | LIBUSB_RECIPIENT_DEVICE,
+        HACKRF_VENDOR_REQUEST_SAMPLE_RATE_IN_STREAM,
+        0,
+        0,
+        (unsigned char*)&params,
+        length,
+        0);
+
+    if(result < length) {
+        last_libusb_error = result;
+        return HACKRF_ERROR_LIBUSB;
+    }
+
+    if(change == NULL) {
+        return HACKRF_SUCCESS;
+    }
+    return hackrf_get_rate_change(device, change);
+}
+
+enum hackrf_error ADDCALL
+hackrf_get_rate_change(hackrf_device*      device,
+                       hackrf_rate_change* change) {
+    // FIXME: what if `device == NULL`?
+    // FIXME: what if `change == NULL`?
+
+    USB_API_REQUIRED(device, 0x0104);
+
+    uint8_t length = sizeof(hackrf_rate_change);
+
+    enum libusb_error result = libusb_control_transfer(
+        device->usb_device,
+        LIBUSB_ENDPOINT_IN | LIBUSB_REQUEST_TYPE_VENDOR | LIBUSB_RECIPIENT_DEVICE,
+        HACKRF_VENDOR_REQUEST_GET_RATE_CHANGE,
+        0,
+        0,
+        (unsigned char*)change,
+        length,
+        0);
+
+    if(result < length) {
+        last_libusb_error = result;
+        return HACKRF_ERROR_LIBUSB;
+    }
+
+    change->glitch_start = TO_LE64(change->glitch_start);
+    change->first_sample = TO_LE64(change->first_sample);
+    change->freq_hz      = TO_LE32(change->freq_hz);
+    change->divider      = TO_LE32(change->divider);
+    change->bandwidth_hz = TO_LE32(change->bandwidth_hz);
+    change->changes      = TO_LE32(change->changes);
+
+    return HACKRF_SUCCESS;
+}
+
+// The Si5351C PLL feeding the multisynths runs at 800 MHz. MS0 runs at
+// twice the sample rate times the R divider, CLK0 divides it by two more.
+#define SI5351C_VCO_HZ 800000000ULL
+#define SI5351C_MS_DIV_MIN 8
+#define SI5351C_MS_DIV_MAX 2048
+#define SI5351C_MS_DEN_MAX ((1 << 20) - 1)
+#define SI5351C_R_DIV_MAX 6
+
+static uint64_t gcd64(uint64_t u, uint64_t v) {
+    while(v) {
+        uint64_t t = u % v;
+        u = v;
+        v = t;
+    }
+    return u;
+}
+
+static double abs_diff(double x, double y) {
+    return (x > y) ? (x - y) : (y - x);
+}
+
+// Closest fraction to x with a denominator no larger than max_den, from
+// the continued fraction convergents and the last semiconvergent.
+static void best_rational(double    x,
+                          uint64_t  max_den,
+                          uint64_t* num,
+                          uint64_t* den) {
+    uint64_t p0 = 0, q0 = 1, p1 = 1, q1 = 0;
+    double f = x;
+    int i;
+
+    for(i = 0; i < 64; i++) {
+        const uint64_t a = (uint64_t)f;
+        if(q0 + a * q1 > max_den) {
+            const uint64_t k = (max_den - q0) / q1;
+            const uint64_t ps = p0 + k * p1;
+            const uint64_t qs = q0 + k * q1;
+            if(abs_diff(x, (double)ps / qs) < abs_diff(x, (double)p1 / q1)) {
+                p1 = ps;
+                q1 = qs;
+            }
+            break;
+        }
+
+        const uint64_t p2 = p0 + a * p1;
+        const uint64_t q2 = q0 + a * q1;
+        p0 = p1;
+        q0 = q1;
+        p1 = p2;
+        q1 = q2;
+
+        if(f == (double)a) {
+            break;
+        }
+        f = 1.0 / (f - (double)a);
+    }
+
+    *num = p1;
+    *den = q1;
+}
+
+enum hackrf_error ADDCALL
+hackrf_compute_sample_rate(double                       freq,
+                           double                       integer_ppm,
+                           hackrf_sample_rate_solution* solution) {
+    // FIXME: what if `solution == NULL`?
+
+    if(!(freq > 0.0)) {
+        return HACKRF_ERROR_INVALID_PARAM;
+    }
+
+    // Use the smallest R divider that brings MS0 into range, keeping the
+    // multisynth output as high as possible.
+    uint32_t r_div;
+    double divider = 0.0;
+    for(r_div = 0; r_div <= SI5351C_R_DIV_MAX; r_div++) {
+        divider = (double)SI5351C_VCO_HZ / (freq * (2 << r_div));
+        if(divider <= SI5351C_MS_DIV_MAX) {
+            break;
+        }
+    }
+    if((r_div > SI5351C_R_DIV_MAX) || (divider < SI5351C_MS_DIV_MIN)) {
+        return HACKRF_ERROR_INVALID_PARAM;
+    }
+
+    // divider = a + b / c
+    uint64_t num, den;
+    best_rational(divider, SI5351C_MS_DEN_MAX, &num, &den);
+    if(num > (uint64_t)SI5351C_MS_DIV_MAX * den) {
+        num = (uint64_t)SI5351C_MS_DIV_MAX * den;
+    }
+
+    // An even integer divider runs the multisynth in integer mode, which
+    // has less jitter. Take it if it is close enough.
+    const uint64_t even = 2 * (uint64_t)(divider / 2.0 + 0.5);
+    if((even >= SI5351C_MS_DIV_MIN) && (even <= SI5351C_MS_DIV_MAX)
+            && (abs_diff(divider, (double)even) * 1e6 <= integer_ppm * divider)) {
+        num = even;
+        den = 1;
+    }
+    if(num < (uint64_t)SI5351C_MS_DIV_MIN * den) {
+        return HACKRF_ERROR_INVALID_PARAM;
+    }
+
+    const uint64_t a = num / den;
+    const uint64_t b = num % den;
+    const uint64_t c = (b == 0) ? 1 : den;
+    const uint64_t b128 = (128 * b) / c;
+
+    solution->p1 = (uint32_t)(128 * a + b128 - 512);
+    solution->p2 = (uint32_t)(128 * b - c * b128);
+    solution->p3 = (uint32_t)c;
+    solution->r_div = r_div;
+    solution->integer_mode = (b == 0) && ((a & 1) == 0);
+
+    // rate = VCO / (2^(r_div + 1) * (a + b / c))
+    uint64_t rate_num = SI5351C_VCO_HZ * c;
+    uint64_t rate_den = (a * c + b) << (r_div + 1);
+    const uint64_t g = gcd64(rate_num, rate_den);
+    solution->rate_num = rate_num / g;
+    solution->rate_den = rate_den / g;
+
+    const double rate = (double)solution->rate_num / (double)solution->rate_den;
+    solution->ppm_error = (rate - freq) * 1e6 / freq;
+
+    return HACKRF_SUCCESS;
+}
+
+/// @private
+typedef struct {
+    uint32_t p1;
+    uint32_t p2;
+    uint32_t p3;
+    uint32_t r_div;
+    uint32_t bandwidth_hz;
+} set_multisynth_params_t;
+
+enum hackrf_error ADDCALL
+hackrf_set_sample_rate_solution(hackrf_device*                     device,
+                                const hackrf_sample_rate_solution* solution) {
+    // FIXME: what if `device == NULL`?
+    // FIXME: what if `solution == NULL`?
+
+    USB_API_REQUIRED(device, 0x0104);
+
+    const double rate = (double)solution->rate_num / (double)solution->rate_den;
+
+    set_multisynth_params_t params;
+    params.p1           = TO_LE32(solution->p1);
+    params.p2           = TO_LE32(solution->p2);
+    params.p3           = TO_LE32(solution->p3);
+    params.r_div        = TO_LE32(solution->r_div);
+    params.bandwidth_hz = TO_LE32(hackrf_compute_baseband_filter_bw((uint32_t)(0.75*rate)));
+
+    uint8_t length = sizeof(set_multisynth_params_t);
+
+    enum libusb_error result = libusb_control_transfer(
+        device->usb_device,
+        LIBUSB_ENDPOINT_OUT | LIBUSB_REQUEST_TYPE_VENDOR | LIBUSB_RECIPIENT_DEVICE,
+        HACKRF_VENDOR_REQUEST_SAMPLE_RATE_MULTISYNTH,
+        0,
+        0,
+        (unsigned char*)&params,
+        length,
+        0);
+
+    if(result < length) {
+        last_libusb_error = result;
+        return HACKRF_ERROR_LIBUSB;
+    }
+
+    return HACKRF_SUCCESS;
+}
+
+enum hackrf_error ADDCALL
+hackrf_set_sample_rate_exact(hackrf_device*               device,
+                             double                       freq,
+                             hackrf_sample_rate_solution* solution) {
+    // FIXME: what if `device == NULL`?
+
+    // Adaptive receivers tend to go back and forth between a few rates.
+    if(freq != device->sample_rate_request) {
+        enum hackrf_error result = hackrf_compute_sample_rate(
+            freq, 0.0, &device->sample_rate_solution);
+        if(result != HACKRF_SUCCESS) {
+            device->sample_rate_request = 0.0;
+            return result;
+        }
+        device->sample_rate_request = freq;
+    }
+
+    if(solution != NULL) {
+        *solution = device->sample_rate_solution;
+    }
+    return hackrf_set_sample_rate_solution(device, &device->sample_rate_solution);
+}
+
+// Only used by hackrf_start_rx_config() / hackrf_start_tx_config().
+#define HACKRF_CONFIG_TRANSCEIVER_MODE (1 << 8)
+
+/// @private
+typedef struct {
+    uint32_t flags;
+    uint32_t freq_mhz;
+    uint32_t freq_hz;
+    uint32_t sample_rate_hz;
+    uint32_t sample_rate_divider;
+    uint32_t bandwidth_hz;
+    uint32_t lna_gain;
+    uint32_t vga_gain;
+    uint32_t txvga_gain;
+    uint32_t amp_enable;
+    uint32_t antenna_enable;
+    uint32_t transceiver_mode;
+} config_bundle_t;
+
+static enum hackrf_error
+send_config(hackrf_device*       device,
+            const hackrf_config* config,
+            uint32_t             flags,
+            uint32_t             transceiver_mode) {
+    USB_API_REQUIRED(device, 0x0104);
+
+    config_bundle_t bundle;
+    memset(&bundle, 0, sizeof(bundle));
+
+    if(flags & HACKRF_CONFIG_FREQ) {
+        bundle.freq_mhz = TO_LE32((uint32_t)(config->freq_hz / FREQ_ONE_MHZ));
+        bundle.freq_hz  = TO_LE32((uint32_t)(config->freq_hz % FREQ_ONE_MHZ));
+    }
+    if(flags & HACKRF_CONFIG_BASEBAND_FILTER) {
+        bundle.bandwidth_hz = TO_LE32(config->baseband_filter_bw_hz);
+    }
+    if(flags & HACKRF_CONFIG_SAMPLE_RATE) {
+        uint32_t freq_hz, divider;
+        compute_fracrate(config->sample_rate_hz, &freq_hz, &divider);
+        bundle.sample_rate_hz      = TO_LE32(freq_hz);
+        bundle.sample_rate_divider = TO_LE32(divider);
+
+        // Same automatic filter choice as hackrf_set_sample_rate().
+        if(!(flags & HACKRF_CONFIG_BASEBAND_FILTER)) {
+            flags |= HACKRF_CONFIG_BASEBAND_FILTER;
+            bundle.bandwidth_hz = TO_LE32(hackrf_compute_baseband_filter_bw((uint32_t)(0.75*freq_hz/divider)));
+        }
+    }
+    bundle.lna_gain         = TO_LE32(config->lna_gain);
+    bundle.vga_gain         = TO_LE32(config->vga_gain);
+    bundle.txvga_gain       = TO_LE32(config->txvga_gain);
+    bundle.amp_enable       = TO_LE32(config->amp_enable);
+    bundle.antenna_enable   = TO_LE32(config->antenna_enable);
+    bundle.transceiver_mode = TO_LE32(transceiver_mode);
+    bundle.flags            = TO_LE32(flags);
+
+    uint8_t length = sizeof(config_bundle_t);
+
+    enum libusb_error result = libusb_control_transfer(
+        device->usb_device,
+        LIBUSB_ENDPOINT_OUT | LIBUSB_REQUEST_TYPE_VENDOR | LIBUSB_RECIPIENT_DEVICE,
+        HACKRF_VENDOR_REQUEST_APPLY_CONFIG,
+        0,
+        0,
+        (unsigned char*)&bundle,
+        length,
+        0);
+
+    if(result < length) {
+        last_libusb_error = result;
+        return HACKRF_ERROR_LIBUSB;
+    }
+
+    return HACKRF_SUCCESS;
+}
+
+enum hackrf_error ADDCALL
+hackrf_apply_config(hackrf_device*       device,
+                    const hackrf_config* config) {
+    // FIXME: what if `device == NULL`?
+    // FIXME: what if `config == NULL`?
+
+    return send_config(device, config,
+                       config->flags & ~HACKRF_CONFIG_TRANSCEIVER_MODE, 0);
+}
+
+enum hackrf_error ADDCALL
+hackrf_get_config_result(hackrf_device*        device,
+                         hackrf_config_result* result) {
+    // FIXME: what if `device == NULL`?
+    // FIXME: what if `result == NULL`?
+
+    USB_API_REQUIRED(device, 0x0104);
+
+    uint8_t length = sizeof(hackrf_config_result);
+
+    enum libusb_error usb_result = libusb_control_transfer(
+        device->usb_device,
+        LIBUSB_ENDPOINT_IN | LIBUSB_REQUEST_TYPE_VENDOR | LIBUSB_RECIPIENT_DEVICE,
+        HACKRF_VENDOR_REQUEST_GET_CONFIG_RESULT,
+        0,
+        0,
+        (unsigned char*)result,
+        length,
+        0);
+
+    if(usb_result < length) {
+        last_libusb_error = usb_result;
+        return HACKRF_ERROR_LIBUSB;
+    }
+
+    result->applied          = TO_LE32(result->applied);
+    result->failed           = TO_LE32(result->failed);
+    result->transceiver_mode = TO_LE32(result->transceiver_mode);
+    result->cycles           = TO_LE32(result->cycles);
+
+    return HACKRF_SUCCESS;
+}
+
 enum hackrf_error ADDCALL
 hackrf_set_amp_enable(hackrf_device* device,
                       uint8_t        value) {
@@ -1608,6 +2072,12 @@ hackrf_libusb_transfer_callback(struct libusb_transfer* usb_transfer) {
     // FIXME: what if `usb_transfer == NULL`?
 
     hackrf_device* device = (hackrf_device*) usb_transfer->user_data;
+    hackrf_sample_block_cb_fn callback = device->callback;
+
+    if(((usb_transfer->endpoint & LIBUSB_ENDPOINT_IN) == 0)
+       && (device->tx_callback != NULL)) {
+        callback = device->tx_callback;
+    }
 
     if(usb_transfer->status == LIBUSB_TRANSFER_COMPLETED) {
         hackrf_transfer transfer = {
@@ -1619,7 +2089,7 @@ hackrf_libusb_transfer_callback(struct libusb_transfer* usb_transfer) {
             .tx_ctx = device->tx_ctx
         };
 
-        if(device->callback(&transfer) == 0) {
+        if(callback(&transfer) == 0) {
             if(libusb_submit_transfer(usb_transfer) < 0) {
                 request_exit();
             } else {
@@ -1662,6 +2132,24 @@ kill_transfer_thread(hackrf_device* device) {
     return HACKRF_SUCCESS;
 }
 
+static enum hackrf_error
+start_transfer_thread(hackrf_device*            device,
+                      hackrf_sample_block_cb_fn callback,
+                      hackrf_sample_block_cb_fn tx_callback) {
+    // FIXME: what if `device == NULL`?
+
+    device->streaming = true;
+    device->callback = callback;
+    device->tx_callback = tx_callback;
+    if(pthread_create(&device->transfer_thread, 0, transfer_threadproc, device) == 0) {
+        device->transfer_thread_started = true;
+    } else {
+        return HACKRF_ERROR_THREAD;
+    }
+
+    return HACKRF_SUCCESS;
+}
+
 static enum hackrf_error
 create_transfer_thread(hackrf_device*            device,
                        uint8_t                   endpoint_address,
@@ -1680,22 +2168,38 @@ create_transfer_thread(hackrf_device*            device,
             }
         }
 
-        device->streaming = true;
-        device->callback = callback;
-        if(pthread_create(&device->transfer_thread, 0, transfer_threadproc, device) == 0) {
-            device->transfer_thread_started = true;
-        } else {
-            return HACKRF_ERROR_THREAD;
-        }
+        return start_transfer_thread(device, callback, NULL);
     } else {
         return HACKRF_ERROR_BUSY;
     }
-
-    return HACKRF_SUCCESS;
 }
 
-enum hackrf_error ADDCALL
-hackrf_is_streaming(hackrf_device* device) {
+static enum hackrf_error
+create_duplex_transfer_thread(hackrf_device*            device,
+                              hackrf_sample_block_cb_fn rx_callback,
+                              hackrf_sample_block_cb_fn tx_callback) {
+    // FIXME: what if `device == NULL`?
+
+    if(device->transfer_thread_started == false) {
+        device->streaming = false;
+        do_exit = false;
+
+        {
+            enum hackrf_error result = prepare_duplex_transfers(device, hackrf_libusb_transfer_callback);
+
+            if(result != HACKRF_SUCCESS) {
+                return result;
+            }
+        }
+
+        return start_transfer_thread(device, rx_callback, tx_callback);
+    } else {
+        return HACKRF_ERROR_BUSY;
+    }
+}
+
+enum hackrf_error ADDCALL
+hackrf_is_streaming(hackrf_device* device) {
     // FIXME: what if `device == NULL`?
 
     // return hackrf is streaming only when streaming, transfer_thread_started are true and do_exit equal false
@@ -1771,6 +2275,52 @@ hackrf_start_tx(hackrf_device*            device,
     return create_transfer_thread(device, endpoint_address, callback);
 }
 
+enum hackrf_error ADDCALL
+hackrf_start_rx_config(hackrf_device*            device,
+                       const hackrf_config*      config,
+                       hackrf_sample_block_cb_fn callback,
+                       void*                     rx_ctx) {
+    // FIXME: what if `device == NULL`?
+    // FIXME: what if `config == NULL`?
+
+    const uint8_t endpoint_address = LIBUSB_ENDPOINT_IN | 1;
+
+    enum hackrf_error result = send_config(
+        device, config,
+        config->flags | HACKRF_CONFIG_TRANSCEIVER_MODE,
+        HACKRF_TRANSCEIVER_MODE_RECEIVE);
+
+    if(result != HACKRF_SUCCESS) {
+        return result;
+    }
+
+    device->rx_ctx = rx_ctx;
+    return create_transfer_thread(device, endpoint_address, callback);
+}
+
+enum hackrf_error ADDCALL
+hackrf_start_tx_config(hackrf_device*            device,
+                       const hackrf_config*      config,
+                       hackrf_sample_block_cb_fn callback,
+                       void*                     tx_ctx) {
+    // FIXME: what if `device == NULL`?
+    // FIXME: what if `config == NULL`?
+
+    const uint8_t endpoint_address = LIBUSB_ENDPOINT_OUT | 2;
+
+    enum hackrf_error result = send_config(
+        device, config,
+        config->flags | HACKRF_CONFIG_TRANSCEIVER_MODE,
+        HACKRF_TRANSCEIVER_MODE_TRANSMIT);
+
+    if(result != HACKRF_SUCCESS) {
+        return result;
+    }
+
+    device->tx_ctx = tx_ctx;
+    return create_transfer_thread(device, endpoint_address, callback);
+}
+
 enum hackrf_error ADDCALL
 hackrf_stop_tx(hackrf_device* device) {
     // FIXME: what if `device == NULL`?
@@ -1786,6 +2336,112 @@ hackrf_stop_tx(hackrf_device* device) {
     return result1;
 }
 
+enum hackrf_error ADDCALL
+hackrf_start_tx_echo(hackrf_device*            device,
+                     hackrf_sample_block_cb_fn rx_callback,
+                     void*                     rx_ctx,
+                     hackrf_sample_block_cb_fn tx_callback,
+                     void*                     tx_ctx) {
+    // FIXME: what if `device == NULL`?
+
+    USB_API_REQUIRED(device, 0x0104);
+
+    enum hackrf_error result
+        = hackrf_set_transceiver_mode(device, HACKRF_TRANSCEIVER_MODE_TX_ECHO);
+
+    if(result != HACKRF_SUCCESS) {
+        return result;
+    }
+
+    device->rx_ctx = rx_ctx;
+    device->tx_ctx = tx_ctx;
+    return create_duplex_transfer_thread(device, rx_callback, tx_callback);
+}
+
+enum hackrf_error ADDCALL
+hackrf_stop_tx_echo(hackrf_device* device) {
+    // FIXME: what if `device == NULL`?
+
+    enum hackrf_error result1 = kill_transfer_thread(device);
+    enum hackrf_error result2
+        = hackrf_set_transceiver_mode(device, HACKRF_TRANSCEIVER_MODE_OFF);
+
+    if(result2 != HACKRF_SUCCESS) {
+        return result2;
+    }
+
+    return result1;
+}
+
+enum hackrf_error ADDCALL
+hackrf_start_tdd(hackrf_device*            device,
+                 hackrf_sample_block_cb_fn rx_callback,
+                 void*                     rx_ctx,
+                 hackrf_sample_block_cb_fn tx_callback,
+                 void*                     tx_ctx) {
+    // FIXME: what if `device == NULL`?
+
+    USB_API_REQUIRED(device, 0x0104);
+
+    enum hackrf_error result
+        = hackrf_set_transceiver_mode(device, HACKRF_TRANSCEIVER_MODE_RECEIVE);
+
+    if(result != HACKRF_SUCCESS) {
+        return result;
+    }
+
+    // Switching brings up the OUT endpoint alongside the IN endpoint.
+    result = hackrf_switch_direction(device, 0, NULL);
+
+    if(result != HACKRF_SUCCESS) {
+        return result;
+    }
+
+    device->rx_ctx = rx_ctx;
+    device->tx_ctx = tx_ctx;
+    return create_duplex_transfer_thread(device, rx_callback, tx_callback);
+}
+
+enum hackrf_error ADDCALL
+hackrf_switch_direction(hackrf_device* device,
+                        const uint8_t  transmit,
+                        uint32_t*      cycles) {
+    // FIXME: what if `device == NULL`?
+
+    USB_API_REQUIRED(device, 0x0104);
+
+    uint32_t switch_cycles = 0;
+    uint8_t length = sizeof(switch_cycles);
+
+    enum libusb_error result = libusb_control_transfer(
+        device->usb_device,
+        LIBUSB_ENDPOINT_IN | LIBUSB_REQUEST_TYPE_VENDOR | LIBUSB_RECIPIENT_DEVICE,
+        HACKRF_VENDOR_REQUEST_SWITCH_DIRECTION,
+        transmit ? HACKRF_TRANSCEIVER_MODE_TRANSMIT : HACKRF_TRANSCEIVER_MODE_RECEIVE,
+        0,
+        (unsigned char*)&switch_cycles,
+        length,
+        0);
+
+    if(result < length) {
+        last_libusb_error = result;
+        return HACKRF_ERROR_LIBUSB;
+    }
+
+    if(cycles != NULL) {
+        *cycles = TO_LE32(switch_cycles);
+    }
+
+    return HACKRF_SUCCESS;
+}
+
+enum hackrf_error ADDCALL
+hackrf_stop_tdd(hackrf_device* device) {
+    // FIXME: what if `device == NULL`?
+
+    return hackrf_stop_tx_echo(device);
+}
+
 enum hackrf_error ADDCALL
 hackrf_close(hackrf_device* device) {
     // FIXME: what if `device == NULL`?
@@ -2072,6 +2728,515 @@ hackrf_init_sweep(hackrf_device*   device,
     return HACKRF_SUCCESS;
 }
 
+// Initialize sweep mode with an explicit list of hops:
+// hops is a list of tuning frequencies in Hz, each with its own dwell time.
+// num_hops is the number of entries in hops (1 to MAX_SWEEP_HOPS)
+// The list is sent to the device in chunks of SWEEP_HOPS_PER_CHUNK entries;
+// sweep mode starts once the last chunk has been received.
+enum hackrf_error ADDCALL
+hackrf_init_sweep_hops(hackrf_device*          device,
+                       const hackrf_sweep_hop* hops,
+                       int                     num_hops) {
+    // FIXME: what if `device == NULL`?
+    // FIXME: what if `hops == NULL`?
+
+    USB_API_REQUIRED(device, 0x0104);
+
+    unsigned char data[SWEEP_HOPS_PER_CHUNK * SWEEP_HOP_ENTRY_SIZE];
+    int first;
+
+    if((num_hops < 1) || (num_hops > MAX_SWEEP_HOPS)) {
+        return HACKRF_ERROR_INVALID_PARAM;
+    }
+
+    for(first = 0; first < num_hops; first++) {
+        if(hops[first].num_bytes % BYTES_PER_BLOCK) {
+            return HACKRF_ERROR_INVALID_PARAM;
+        }
+        if(BYTES_PER_BLOCK > hops[first].num_bytes) {
+            return HACKRF_ERROR_INVALID_PARAM;
+        }
+        if((hops[first].num_bytes / BYTES_PER_BLOCK) > 0xffff) {
+            return HACKRF_ERROR_INVALID_PARAM;
+        }
+    }
+
+    for(first = 0; first < num_hops; first += SWEEP_HOPS_PER_CHUNK) {
+        int count = num_hops - first;
+        int size;
+        int i;
+
+        if(count > SWEEP_HOPS_PER_CHUNK) {
+            count = SWEEP_HOPS_PER_CHUNK;
+        }
+        size = count * SWEEP_HOP_ENTRY_SIZE;
+
+        for(i = 0; i < count; i++) {
+            const uint64_t freq = hops[first + i].frequency;
+            const uint32_t blocks = hops[first + i].num_bytes / BYTES_PER_BLOCK;
+            unsigned char* entry = &data[i * SWEEP_HOP_ENTRY_SIZE];
+            int j;
+
+            for(j = 0; j < 8; j++) {
+                entry[j] = (freq >> (8 * j)) & 0xff;
+            }
+            entry[8] = blocks & 0xff;
+            entry[9] = (blocks >> 8) & 0xff;
+        }
+
+        enum libusb_error result = libusb_control_transfer(
+            device->usb_device,
+            LIBUSB_ENDPOINT_OUT | LIBUSB_REQUEST_TYPE_VENDOR | LIBUSB_RECIPIENT_DEVICE,
+            HACKRF_VENDOR_REQUEST_INIT_SWEEP_HOPS,
+            first,
+            num_hops,
+            data,
+            size,
+            0);
+
+        if(result < size) {
+            last_libusb_error = result;
+            return HACKRF_ERROR_LIBUSB;
+        }
+    }
+
+    return HACKRF_SUCCESS;
+}
+
+// Retrieve retune timing measured by the device during sweep mode.
+enum hackrf_error ADDCALL
+hackrf_get_sweep_stats(hackrf_device*      device,
+                       hackrf_sweep_stats* stats) {
+    // FIXME: what if `device == NULL`?
+    // FIXME: what if `stats == NULL`?
+
+    USB_API_REQUIRED(device, 0x0104);
+
+    uint8_t length = sizeof(hackrf_sweep_stats);
+
+    enum libusb_error result = libusb_control_transfer(
+        device->usb_device,
+        LIBUSB_ENDPOINT_IN | LIBUSB_REQUEST_TYPE_VENDOR | LIBUSB_RECIPIENT_DEVICE,
+        HACKRF_VENDOR_REQUEST_GET_SWEEP_STATS,
+        0,
+        0,
+        (unsigned char*)stats,
+        length,
+        0);
+
+    if(result < length) {
+        last_libusb_error = result;
+        return HACKRF_ERROR_LIBUSB;
+    }
+
+    stats->hops                = TO_LE32(stats->hops);
+    stats->last_retune_samples = TO_LE32(stats->last_retune_samples);
+    stats->max_retune_samples  = TO_LE32(stats->max_retune_samples);
+    stats->lock_timeouts       = TO_LE32(stats->lock_timeouts);
+    stats->discarded_blocks    = TO_LE32(stats->discarded_blocks);
+
+    return HACKRF_SUCCESS;
+}
+
+enum hackrf_error ADDCALL
+hackrf_get_tuning_stats(hackrf_device*       device,
+                        hackrf_tuning_stats* stats) {
+    // FIXME: what if `device == NULL`?
+    // FIXME: what if `stats == NULL`?
+
+    USB_API_REQUIRED(device, 0x0104);
+
+    uint8_t length = sizeof(hackrf_tuning_stats);
+
+    enum libusb_error result = libusb_control_transfer(
+        device->usb_device,
+        LIBUSB_ENDPOINT_IN | LIBUSB_REQUEST_TYPE_VENDOR | LIBUSB_RECIPIENT_DEVICE,
+        HACKRF_VENDOR_REQUEST_GET_TUNING_STATS,
+        0,
+        0,
+        (unsigned char*)stats,
+        length,
+        0);
+
+    if(result < length) {
+        last_libusb_error = result;
+        return HACKRF_ERROR_LIBUSB;
+    }
+
+    stats->retunes         = TO_LE32(stats->retunes);
+    stats->fast_retunes    = TO_LE32(stats->fast_retunes);
+    stats->filter_changes  = TO_LE32(stats->filter_changes);
+    stats->mixer_changes   = TO_LE32(stats->mixer_changes);
+    stats->max2837_changes = TO_LE32(stats->max2837_changes);
+    stats->last_cycles     = TO_LE32(stats->last_cycles);
+    stats->max_cycles      = TO_LE32(stats->max_cycles);
+
+    return HACKRF_SUCCESS;
+}
+
+/// @private
+typedef struct {
+    uint64_t sample;
+    uint64_t arg;
+    uint32_t type;
+    uint32_t reserved;
+} schedule_command_t;
+
+enum hackrf_error ADDCALL
+hackrf_schedule_command(hackrf_device*             device,
+                        uint64_t                   sample,
+                        enum hackrf_scheduled_type type,
+                        uint64_t                   arg) {
+    // FIXME: what if `device == NULL`?
+
+    USB_API_REQUIRED(device, 0x0104);
+
+    schedule_command_t command;
+    command.sample   = TO_LE64(sample);
+    command.arg      = TO_LE64(arg);
+    command.type     = TO_LE32((uint32_t)type);
+    command.reserved = 0;
+
+    uint8_t length = sizeof(schedule_command_t);
+
+    enum libusb_error result = libusb_control_transfer(
+        device->usb_device,
+        LIBUSB_ENDPOINT_OUT | LIBUSB_REQUEST_TYPE_VENDOR | LIBUSB_RECIPIENT_DEVICE,
+        HACKRF_VENDOR_REQUEST_SCHEDULE_COMMAND,
+        0,
+        0,
+        (unsigned char*)&command,
+        length,
+        0);
+
+    if(result < length) {
+        last_libusb_error = result;
+        return HACKRF_ERROR_LIBUSB;
+    }
+
+    return HACKRF_SUCCESS;
+}
+
+enum hackrf_error ADDCALL
+hackrf_schedule_operacake_ports(hackrf_device* device,
+                                uint64_t       sample,
+                                uint8_t        address,
+                                uint8_t        port_a,
+                                uint8_t        port_b) {
+    const uint64_t arg = address | (port_a << 8) | (port_b << 16);
+    return hackrf_schedule_command(device, sample,
+                                   HACKRF_SCHEDULED_OPERACAKE_PORTS, arg);
+}
+
+enum hackrf_error ADDCALL
+hackrf_clear_schedule(hackrf_device* device) {
+    // FIXME: what if `device == NULL`?
+
+    USB_API_REQUIRED(device, 0x0104);
+
+    enum libusb_error result = libusb_control_transfer(
+        device->usb_device,
+        LIBUSB_ENDPOINT_OUT | LIBUSB_REQUEST_TYPE_VENDOR | LIBUSB_RECIPIENT_DEVICE,
+        HACKRF_VENDOR_REQUEST_CLEAR_SCHEDULE,
+        0,
+        0,
+        NULL,
+        0,
+        0);
+
+    if(result != LIBUSB_SUCCESS) {
+        last_libusb_error = result;
+        return HACKRF_ERROR_LIBUSB;
+    }
+
+    return HACKRF_SUCCESS;
+}
+
+enum hackrf_error ADDCALL
+hackrf_get_schedule_stats(hackrf_device*         device,
+                          hackrf_schedule_stats* stats) {
+    // FIXME: what if `device == NULL`?
+    // FIXME: what if `stats == NULL`?
+
+    USB_API_REQUIRED(device, 0x0104);
+
+    uint8_t length = sizeof(hackrf_schedule_stats);
+
+    enum libusb_error result = libusb_control_transfer(
+        device->usb_device,
+        LIBUSB_ENDPOINT_IN | LIBUSB_REQUEST_TYPE_VENDOR | LIBUSB_RECIPIENT_DEVICE,
+        HACKRF_VENDOR_REQUEST_GET_SCHEDULE_STATS,
+        0,
+        0,
+        (unsigned char*)stats,
+        length,
+        0);
+
+    if(result < length) {
+        last_libusb_error = result;
+        return HACKRF_ERROR_LIBUSB;
+    }
+
+    stats->queued        = TO_LE32(stats->queued);
+    stats->executed      = TO_LE32(stats->executed);
+    stats->failed        = TO_LE32(stats->failed);
+    stats->dropped       = TO_LE32(stats->dropped);
+    stats->max_lateness  = TO_LE32(stats->max_lateness);
+    stats->last_sample   = TO_LE64(stats->last_sample);
+    stats->last_executed = TO_LE64(stats->last_executed);
+
+    return HACKRF_SUCCESS;
+}
+
+enum hackrf_error ADDCALL
+hackrf_get_cpu_idle(hackrf_device*   device,
+                    hackrf_cpu_idle* idle) {
+    // FIXME: what if `device == NULL`?
+    // FIXME: what if `idle == NULL`?
+
+    USB_API_REQUIRED(device, 0x0104);
+
+    uint8_t length = sizeof(hackrf_cpu_idle);
+
+    enum libusb_error result = libusb_control_transfer(
+        device->usb_device,
+        LIBUSB_ENDPOINT_IN | LIBUSB_REQUEST_TYPE_VENDOR | LIBUSB_RECIPIENT_DEVICE,
+        HACKRF_VENDOR_REQUEST_GET_CPU_IDLE,
+        0,
+        0,
+        (unsigned char*)idle,
+        length,
+        0);
+
+    if(result < length) {
+        last_libusb_error = result;
+        return HACKRF_ERROR_LIBUSB;
+    }
+
+    idle->idle_cycles  = TO_LE64(idle->idle_cycles);
+    idle->total_cycles = TO_LE64(idle->total_cycles);
+
+    return HACKRF_SUCCESS;
+}
+
+enum hackrf_error ADDCALL
+hackrf_get_usb_errors(hackrf_device*     device,
+                      hackrf_usb_errors* errors) {
+    // FIXME: what if `device == NULL`?
+    // FIXME: what if `errors == NULL`?
+
+    USB_API_REQUIRED(device, 0x0104);
+
+    uint8_t length = sizeof(hackrf_usb_errors);
+
+    enum libusb_error result = libusb_control_transfer(
+        device->usb_device,
+        LIBUSB_ENDPOINT_IN | LIBUSB_REQUEST_TYPE_VENDOR | LIBUSB_RECIPIENT_DEVICE,
+        HACKRF_VENDOR_REQUEST_GET_USB_ERRORS,
+        0,
+        0,
+        (unsigned char*)errors,
+        length,
+        0);
+
+    if(result < length) {
+        last_libusb_error = result;
+        return HACKRF_ERROR_LIBUSB;
+    }
+
+    errors->halted             = TO_LE32(errors->halted);
+    errors->buffer_errors      = TO_LE32(errors->buffer_errors);
+    errors->transaction_errors = TO_LE32(errors->transaction_errors);
+    errors->missing_queue      = TO_LE32(errors->missing_queue);
+
+    return HACKRF_SUCCESS;
+}
+
+enum hackrf_error ADDCALL
+hackrf_get_buffer_stats(hackrf_device*       device,
+                        hackrf_buffer_stats* stats) {
+    // FIXME: what if `device == NULL`?
+    // FIXME: what if `stats == NULL`?
+
+    int i;
+
+    USB_API_REQUIRED(device, 0x0104);
+
+    uint8_t length = sizeof(hackrf_buffer_stats);
+
+    enum libusb_error result = libusb_control_transfer(
+        device->usb_device,
+        LIBUSB_ENDPOINT_IN | LIBUSB_REQUEST_TYPE_VENDOR | LIBUSB_RECIPIENT_DEVICE,
+        HACKRF_VENDOR_REQUEST_GET_BUFFER_STATS,
+        0,
+        0,
+        (unsigned char*)stats,
+        length,
+        0);
+
+    if(result < length) {
+        last_libusb_error = result;
+        return HACKRF_ERROR_LIBUSB;
+    }
+
+    stats->transfers     = TO_LE32(stats->transfers);
+    stats->overruns      = TO_LE32(stats->overruns);
+    stats->in_flight     = TO_LE32(stats->in_flight);
+    stats->max_in_flight = TO_LE32(stats->max_in_flight);
+    for(i = 0; i < HACKRF_BUFFER_SLOTS; i++) {
+        stats->slot_overruns[i] = TO_LE32(stats->slot_overruns[i]);
+    }
+
+    return HACKRF_SUCCESS;
+}
+
+enum hackrf_error ADDCALL
+hackrf_set_decimation(hackrf_device*            device,
+                      uint32_t                  ratio,
+                      enum hackrf_sample_format format,
+                      double                    nco_freq_hz,
+                      double                    sample_rate_hz) {
+    // FIXME: what if `device == NULL`?
+
+    USB_API_REQUIRED(device, 0x0104);
+
+    uint32_t phase_increment;
+    double cycles;
+    uint8_t length;
+
+    if((ratio > HACKRF_DECIMATION_MAX)
+       || ((ratio > 1) && (ratio < HACKRF_DECIMATION_MIN))) {
+        return HACKRF_ERROR_INVALID_PARAM;
+    }
+    if((format != HACKRF_SAMPLE_FORMAT_CS8)
+       && (format != HACKRF_SAMPLE_FORMAT_CS16)
+       && (format != HACKRF_SAMPLE_FORMAT_CS12)) {
+        return HACKRF_ERROR_INVALID_PARAM;
+    }
+    if(sample_rate_hz <= 0) {
+        return HACKRF_ERROR_INVALID_PARAM;
+    }
+    if((ratio > 1) && (sample_rate_hz > HACKRF_DECIMATION_MAX_INPUT_RATE)) {
+        return HACKRF_ERROR_INVALID_PARAM;
+    }
+
+    // NCO phase advance per input sample, one full turn being 2^32.
+    cycles = nco_freq_hz / sample_rate_hz;
+    cycles -= (double)(int64_t)cycles;
+    if(cycles < 0) {
+        cycles += 1.0;
+    }
+    phase_increment = TO_LE32((uint32_t)(uint64_t)(cycles * 4294967296.0 + 0.5));
+    length = (ratio > 1) ? sizeof(phase_increment) : 0;
+
+    enum libusb_error result = libusb_control_transfer(
+        device->usb_device,
+        LIBUSB_ENDPOINT_OUT | LIBUSB_REQUEST_TYPE_VENDOR | LIBUSB_RECIPIENT_DEVICE,
+        HACKRF_VENDOR_REQUEST_SET_DECIMATION,
+        ratio,
+        format,
+        (unsigned char*)&phase_increment,
+        length,
+        0);
+
+    if(result < length) {
+        last_libusb_error = result;
+        return HACKRF_ERROR_LIBUSB;
+    }
+
+    return HACKRF_SUCCESS;
+}
+
+enum hackrf_error ADDCALL
+hackrf_get_sample_formats(hackrf_device* device,
+                          uint32_t*      formats) {
+    // FIXME: what if `device == NULL`?
+    // FIXME: what if `formats == NULL`?
+
+    USB_API_REQUIRED(device, 0x0104);
+
+    uint8_t length = sizeof(*formats);
+
+    enum libusb_error result = libusb_control_transfer(
+        device->usb_device,
+        LIBUSB_ENDPOINT_IN | LIBUSB_REQUEST_TYPE_VENDOR | LIBUSB_RECIPIENT_DEVICE,
+        HACKRF_VENDOR_REQUEST_GET_SAMPLE_FORMATS,
+        0,
+        0,
+        (unsigned char*)formats,
+        length,
+        0);
+
+    if(result < length) {
+        last_libusb_error = result;
+        return HACKRF_ERROR_LIBUSB;
+    }
+
+    *formats = TO_LE32(*formats);
+
+    return HACKRF_SUCCESS;
+}
+
+// Two cs12 samples (6 bytes) at a time, with no loop-carried state, so
+// the compiler is free to vectorize.
+static size_t
+unpack_cs12(const uint8_t* in,
+            size_t         length,
+            int16_t*       out) {
+    const size_t pairs = length / 6;
+    size_t n;
+
+    for(n = 0; n < pairs; n++) {
+        const uint8_t* p = &in[n * 6];
+        int16_t* o = &out[n * 4];
+        const uint32_t a = p[0] | (p[1] << 8) | (p[2] << 16);
+        const uint32_t b = p[3] | (p[4] << 8) | (p[5] << 16);
+
+        o[0] = (int16_t)(a << 4) >> 4;
+        o[1] = (int16_t)((a >> 8) & 0xfff0) >> 4;
+        o[2] = (int16_t)(b << 4) >> 4;
+        o[3] = (int16_t)((b >> 8) & 0xfff0) >> 4;
+    }
+    n = pairs * 6;
+
+    if(length - n >= 3) {
+        const uint32_t a = in[n] | (in[n + 1] << 8) | (in[n + 2] << 16);
+        out[pairs * 4]     = (int16_t)(a << 4) >> 4;
+        out[pairs * 4 + 1] = (int16_t)((a >> 8) & 0xfff0) >> 4;
+        n += 3;
+    }
+
+    return n;
+}
+
+size_t ADDCALL
+hackrf_unpack_samples(enum hackrf_sample_format format,
+                      const uint8_t*            in,
+                      size_t                    length,
+                      int16_t*                  out) {
+    size_t n;
+
+    switch(format) {
+    case HACKRF_SAMPLE_FORMAT_CS16:
+        length &= ~(size_t)3;
+        for(n = 0; n < length / 2; n++) {
+            out[n] = (int16_t)(in[n * 2] | (in[n * 2 + 1] << 8));
+        }
+        return length;
+
+    case HACKRF_SAMPLE_FORMAT_CS12:
+        return unpack_cs12(in, length, out);
+
+    case HACKRF_SAMPLE_FORMAT_CS8:
+    default:
+        length &= ~(size_t)1;
+        for(n = 0; n < length; n++) {
+            out[n] = (int8_t)in[n];
+        }
+        return length;
+    }
+}
+
 // Retrieve list of Operacake board addresses
 // boards must be *uint8_t[8]
 enum hackrf_error ADDCALL
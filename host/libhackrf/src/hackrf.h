@@ -40,6 +40,7 @@
 #define HACKRF_H
 
 #include <stdint.h>
+#include <stddef.h>
 
 #ifdef _WIN32
 # define ADD_EXPORTS
@@ -75,6 +76,9 @@
 /// FIXME: doc
 #define MAX_SWEEP_RANGES 10
 
+/// Maximum number of entries in a sweep hop list.
+#define MAX_SWEEP_HOPS 512
+
 // -----------------------------------------------------------------------------
 // -----------------------------------------------------------------------------
 // -----------------------------------------------------------------------------
@@ -146,9 +150,286 @@ enum sweep_style {
     INTERLEAVED = 1,
 };
 
+/// Sample formats produced by on-device decimation.
+enum hackrf_sample_format {
+    /// Interleaved signed 8-bit I and Q.
+    HACKRF_SAMPLE_FORMAT_CS8  = 0,
+
+    /// Interleaved signed 16-bit little-endian I and Q.
+    HACKRF_SAMPLE_FORMAT_CS16 = 1,
+
+    /// Signed 12-bit I and Q packed little-endian into 3 bytes per sample:
+    /// `(I & 0xfff) | ((Q & 0xfff) << 12)`.
+    /// Use \link hackrf_unpack_samples \endlink to expand it.
+    HACKRF_SAMPLE_FORMAT_CS12 = 2,
+};
+
+/// Smallest on-device decimation ratio.
+#define HACKRF_DECIMATION_MIN 2
+
+/// Largest on-device decimation ratio.
+#define HACKRF_DECIMATION_MAX 64
+
+/// Highest sample rate in Hz the device can decimate at without
+/// overrunning its sample buffer.
+#define HACKRF_DECIMATION_MAX_INPUT_RATE 5000000
+
 /// FIXME: doc
 typedef struct hackrf_device hackrf_device;
 
+/// A single entry of a sweep hop list.
+typedef struct {
+    /// Tuning frequency in Hz.
+    uint64_t frequency;
+
+    /// Number of sample bytes to capture at this frequency.
+    /// Must be a multiple of `BYTES_PER_BLOCK`.
+    uint32_t num_bytes;
+} hackrf_sweep_hop;
+
+/// Retune timing measured by the device in sweep mode.
+/// Times are in samples at the current sample rate.
+typedef struct {
+    /// Number of retunes since sweep mode was started.
+    uint32_t hops;
+
+    /// Time from the start of the last retune until PLL lock.
+    uint32_t last_retune_samples;
+
+    /// Longest retune time seen so far.
+    uint32_t max_retune_samples;
+
+    /// Number of retunes that gave up waiting for PLL lock.
+    uint32_t lock_timeouts;
+
+    /// Number of blocks discarded while retuning.
+    uint32_t discarded_blocks;
+} hackrf_sweep_stats;
+
+/// Retune counters kept by the device firmware.
+/// Each retune only reprograms the parts of the radio that differ from the
+/// previous frequency; these show how often each part was touched.
+/// Counts are cumulative since the device was powered up.
+typedef struct {
+    /// Frequency changes applied.
+    uint32_t retunes;
+
+    /// Small hops made by moving only the IF, leaving the mixer alone.
+    uint32_t fast_retunes;
+
+    /// Retunes that switched the RF filter path.
+    uint32_t filter_changes;
+
+    /// Retunes that reprogrammed the mixer LO.
+    uint32_t mixer_changes;
+
+    /// Retunes that reprogrammed the MAX2837 synthesizer.
+    uint32_t max2837_changes;
+
+    /// CPU cycles (204 MHz) spent in the most recent retune.
+    uint32_t last_cycles;
+
+    /// Largest number of CPU cycles spent in one retune.
+    uint32_t max_cycles;
+} hackrf_tuning_stats;
+
+/// Where an in-stream sample rate change landed in the sample stream.
+/// Positions count complex samples from the start of streaming, as taken
+/// by the ADC; with decimation enabled divide by the decimation ratio.
+typedef struct {
+    /// First sample that may have been taken while the clock was changing.
+    uint64_t glitch_start;
+
+    /// First sample known to be taken at the new rate.
+    uint64_t first_sample;
+
+    /// New rate as `freq_hz / divider`.
+    uint32_t freq_hz;
+    uint32_t divider;
+
+    /// Baseband filter bandwidth selected with the new rate.
+    uint32_t bandwidth_hz;
+
+    /// In-stream rate changes made since the device was powered up.
+    uint32_t changes;
+} hackrf_rate_change;
+
+/// Si5351C multisynth settings for a sample rate, as found by
+/// hackrf_compute_sample_rate().
+typedef struct {
+    /// Achieved sample rate is exactly `rate_num / rate_den` Hz.
+    uint64_t rate_num;
+    uint64_t rate_den;
+
+    /// Achieved rate relative to the requested one, in parts per million.
+    double ppm_error;
+
+    /// MS0 register values, encoding the divider `a + b / c`.
+    uint32_t p1;
+    uint32_t p2;
+    uint32_t p3;
+
+    /// Extra R divider, as a power of two, applied after the multisynth.
+    uint32_t r_div;
+
+    /// Nonzero if the multisynth runs in integer mode.
+    uint8_t integer_mode;
+} hackrf_sample_rate_solution;
+
+/// \name Config bundle flags
+/// Settings in a \link hackrf_config \endlink that are applied.
+/// @{
+#define HACKRF_CONFIG_FREQ            (1 << 0)
+#define HACKRF_CONFIG_SAMPLE_RATE     (1 << 1)
+#define HACKRF_CONFIG_BASEBAND_FILTER (1 << 2)
+#define HACKRF_CONFIG_LNA_GAIN        (1 << 3)
+#define HACKRF_CONFIG_VGA_GAIN        (1 << 4)
+#define HACKRF_CONFIG_TXVGA_GAIN      (1 << 5)
+#define HACKRF_CONFIG_AMP             (1 << 6)
+#define HACKRF_CONFIG_ANTENNA         (1 << 7)
+/// @}
+
+/// A set of radio settings applied with a single USB request, see
+/// hackrf_apply_config(). Only the fields whose flag is set are used.
+typedef struct {
+    /// HACKRF_CONFIG_* bits of the settings to apply.
+    uint32_t flags;
+
+    /// Center frequency, as for hackrf_set_freq().
+    uint64_t freq_hz;
+
+    /// Sample rate, as for hackrf_set_sample_rate(). Unless
+    /// HACKRF_CONFIG_BASEBAND_FILTER is also set the filter is chosen
+    /// automatically.
+    double sample_rate_hz;
+
+    /// As for hackrf_set_baseband_filter_bandwidth().
+    uint32_t baseband_filter_bw_hz;
+
+    /// As for hackrf_set_lna_gain(), hackrf_set_vga_gain() and
+    /// hackrf_set_txvga_gain().
+    uint32_t lna_gain;
+    uint32_t vga_gain;
+    uint32_t txvga_gain;
+
+    /// As for hackrf_set_amp_enable() and hackrf_set_antenna_enable().
+    uint8_t amp_enable;
+    uint8_t antenna_enable;
+} hackrf_config;
+
+/// Outcome of the last config bundle, see hackrf_get_config_result().
+typedef struct {
+    /// HACKRF_CONFIG_* bits of the settings that took effect.
+    uint32_t applied;
+
+    /// HACKRF_CONFIG_* bits of the settings the device rejected.
+    uint32_t failed;
+
+    /// Transceiver mode after the bundle was applied.
+    uint32_t transceiver_mode;
+
+    /// CPU cycles (204 MHz) the device spent applying the bundle.
+    uint32_t cycles;
+} hackrf_config_result;
+
+/// Commands that can be scheduled with hackrf_schedule_command().
+enum hackrf_scheduled_type {
+    /// Retune, `arg` is the frequency in Hz as for hackrf_set_freq().
+    HACKRF_SCHEDULED_RETUNE = 0,
+
+    /// Set a gain, `arg` is the gain in dB as for hackrf_set_lna_gain(),
+    /// hackrf_set_vga_gain() or hackrf_set_txvga_gain().
+    HACKRF_SCHEDULED_LNA_GAIN = 1,
+    HACKRF_SCHEDULED_VGA_GAIN = 2,
+    HACKRF_SCHEDULED_TXVGA_GAIN = 3,
+
+    /// Turn a stream started with hackrf_start_tdd() around, as
+    /// hackrf_switch_direction() would. `arg` is unused.
+    HACKRF_SCHEDULED_TX_START = 4,
+    HACKRF_SCHEDULED_TX_STOP = 5,
+
+    /// Switch Operacake ports, see hackrf_schedule_operacake_ports().
+    HACKRF_SCHEDULED_OPERACAKE_PORTS = 6,
+};
+
+/// Scheduled command counters kept by the device firmware.
+/// Changing the transceiver mode drops pending commands but keeps the
+/// counts; only hackrf_clear_schedule() resets them.
+typedef struct {
+    /// Commands waiting to come due.
+    uint32_t queued;
+
+    /// Commands run, including failed ones.
+    uint32_t executed;
+
+    /// Commands the device could not carry out when they came due.
+    uint32_t failed;
+
+    /// Commands refused because the queue was full.
+    uint32_t dropped;
+
+    /// Largest delay, in samples, between a command coming due and running.
+    uint32_t max_lateness;
+
+    uint32_t reserved;
+
+    /// Sample the most recent command was scheduled for.
+    uint64_t last_sample;
+
+    /// Stream position, in samples, when it actually ran.
+    uint64_t last_executed;
+} hackrf_schedule_stats;
+
+/// Processor load counters kept by the device firmware.
+/// Both count M4 core cycles since the device was configured; take the
+/// difference between two reads to get the idle fraction over an interval.
+typedef struct {
+    /// Cycles spent asleep waiting for work.
+    uint64_t idle_cycles;
+
+    /// All cycles accounted for.
+    uint64_t total_cycles;
+} hackrf_cpu_idle;
+
+/// USB transfer errors the device recovered from.
+/// Counts are cumulative since the device was powered up.
+typedef struct {
+    /// Transfers that stopped with the endpoint halted.
+    uint32_t halted;
+
+    /// Transfers that hit a buffer overrun or underrun.
+    uint32_t buffer_errors;
+
+    /// Transfers that failed with a transaction error.
+    uint32_t transaction_errors;
+
+    /// Requests made on an endpoint that was not set up.
+    uint32_t missing_queue;
+} hackrf_usb_errors;
+
+/// Number of slots in the device's sample buffer ring.
+#define HACKRF_BUFFER_SLOTS 4
+
+/// Sample buffer ring counters kept by the device firmware.
+/// They are reset each time the transceiver mode changes.
+typedef struct {
+    /// USB transfers completed.
+    uint32_t transfers;
+
+    /// Times the device reached a slot that was still waiting for the host,
+    /// losing receive samples or repeating stale transmit samples.
+    uint32_t overruns;
+
+    /// Slots currently queued for the host.
+    uint32_t in_flight;
+
+    /// Most slots ever queued for the host at once.
+    uint32_t max_in_flight;
+
+    /// Overruns broken down by slot.
+    uint32_t slot_overruns[HACKRF_BUFFER_SLOTS];
+} hackrf_buffer_stats;
+
 /// FIXME: doc
 typedef struct {
     /// FIXME: doc
@@ -407,6 +688,180 @@ hackrf_start_tx(hackrf_device*            device,
 extern ADDAPI enum hackrf_error ADDCALL
 hackrf_stop_tx(hackrf_device* device);
 
+/// \brief Apply a config bundle and start receiving.
+///
+/// This function requires HackRF USB API version 0x0104 or higher
+///
+/// Same as hackrf_apply_config() followed by hackrf_start_rx(), but the
+/// settings and the switch to receive mode go to the device in one request.
+/// Stop with hackrf_stop_rx().
+///
+/// \param device   FIXME: doc
+/// \param config   settings to apply, see \link hackrf_config \endlink
+/// \param callback FIXME: doc
+/// \param rx_ctx   FIXME: doc
+///
+/// \returns \link HACKRF_ERROR_USB_API_VERSION \endlink
+///          if the HackRF USB API version is lower than `0x0104`.
+/// \returns \link HACKRF_ERROR_THREAD \endlink
+///          if `pthread_create`ing the transfer thread failed.
+/// \returns \link HACKRF_ERROR_BUSY \endlink
+///          if the transfer thread was already started.
+/// \returns \link HACKRF_ERROR_LIBUSB \endlink
+///          if `libusb` had a problem.
+/// \returns \link HACKRF_ERROR_OTHER \endlink
+///          if something that should never happen happens.
+/// \returns \link HACKRF_SUCCESS \endlink otherwise.
+extern ADDAPI enum hackrf_error ADDCALL
+hackrf_start_rx_config(hackrf_device*            device,
+                       const hackrf_config*      config,
+                       hackrf_sample_block_cb_fn callback,
+                       void*                     rx_ctx);
+
+/// \brief Apply a config bundle and start transmitting.
+///
+/// This function requires HackRF USB API version 0x0104 or higher
+///
+/// Same as hackrf_apply_config() followed by hackrf_start_tx(), in one
+/// request. Stop with hackrf_stop_tx().
+///
+/// \param device   FIXME: doc
+/// \param config   settings to apply, see \link hackrf_config \endlink
+/// \param callback FIXME: doc
+/// \param tx_ctx   FIXME: doc
+///
+/// \returns \link HACKRF_ERROR_USB_API_VERSION \endlink
+///          if the HackRF USB API version is lower than `0x0104`.
+/// \returns \link HACKRF_ERROR_THREAD \endlink
+///          if `pthread_create`ing the transfer thread failed.
+/// \returns \link HACKRF_ERROR_BUSY \endlink
+///          if the transfer thread was already started.
+/// \returns \link HACKRF_ERROR_LIBUSB \endlink
+///          if `libusb` had a problem.
+/// \returns \link HACKRF_ERROR_OTHER \endlink
+///          if something that should never happen happens.
+/// \returns \link HACKRF_SUCCESS \endlink otherwise.
+extern ADDAPI enum hackrf_error ADDCALL
+hackrf_start_tx_config(hackrf_device*            device,
+                       const hackrf_config*      config,
+                       hackrf_sample_block_cb_fn callback,
+                       void*                     tx_ctx);
+
+/// \brief Debug mode that echoes every sample sent to the device back to
+///        the host.
+///
+/// The firmware plays the samples out to SGPIO as it would for transmit
+/// and returns a copy of each word as it is written, which exercises both
+/// bulk endpoints at once. The radio is left off, so nothing is
+/// transmitted. The echo is a digital copy, so it cannot measure RF
+/// latency or gain. Half of the transfers are used for each direction.
+///
+/// \param device      FIXME: doc
+/// \param rx_callback called with each block returned by the device
+/// \param rx_ctx      FIXME: doc
+/// \param tx_callback called to fill each block sent to the device
+/// \param tx_ctx      FIXME: doc
+///
+/// \returns \link HACKRF_ERROR_USB_API_VERSION \endlink
+///          if the HackRF USB API version is lower than `0x0104`.
+/// \returns \link HACKRF_ERROR_THREAD \endlink
+///          if `pthread_create`ing the transfer thread failed.
+/// \returns \link HACKRF_ERROR_BUSY \endlink
+///          if the transfer thread was already started.
+/// \returns \link HACKRF_ERROR_LIBUSB \endlink
+///          if `libusb` had a problem, or the firmware was built to move
+///          samples with DMA or the M0 core.
+/// \returns \link HACKRF_ERROR_OTHER \endlink
+///          if something that should never happen happens.
+/// \returns \link HACKRF_SUCCESS \endlink otherwise.
+extern ADDAPI enum hackrf_error ADDCALL
+hackrf_start_tx_echo(hackrf_device*            device,
+                     hackrf_sample_block_cb_fn rx_callback,
+                     void*                     rx_ctx,
+                     hackrf_sample_block_cb_fn tx_callback,
+                     void*                     tx_ctx);
+
+/// \brief Stop a stream started with \link hackrf_start_tx_echo \endlink.
+///
+/// \param device FIXME: doc
+///
+/// \returns \link HACKRF_ERROR_THREAD \endlink
+///          if `pthread_join`ing the transfer thread failed.
+/// \returns \link HACKRF_ERROR_LIBUSB \endlink
+///          if `libusb` had a problem.
+/// \returns \link HACKRF_SUCCESS \endlink otherwise.
+extern ADDAPI enum hackrf_error ADDCALL
+hackrf_stop_tx_echo(hackrf_device* device);
+
+/// \brief Start streaming with both bulk endpoints kept busy, for fast
+///        switching between receive and transmit.
+///
+/// Streaming starts in receive. Half of the transfers wait on each endpoint
+/// and the transfer thread keeps running across
+/// \link hackrf_switch_direction \endlink calls, so turning around only
+/// costs one control request. Transfers on the idle endpoint wait until the
+/// direction changes again. Samples already queued when the direction
+/// changes are dropped.
+///
+/// \param device      FIXME: doc
+/// \param rx_callback called with each received block
+/// \param rx_ctx      FIXME: doc
+/// \param tx_callback called to fill each block to transmit
+/// \param tx_ctx      FIXME: doc
+///
+/// \returns \link HACKRF_ERROR_USB_API_VERSION \endlink
+///          if the HackRF USB API version is lower than `0x0104`.
+/// \returns \link HACKRF_ERROR_THREAD \endlink
+///          if `pthread_create`ing the transfer thread failed.
+/// \returns \link HACKRF_ERROR_BUSY \endlink
+///          if the transfer thread was already started.
+/// \returns \link HACKRF_ERROR_LIBUSB \endlink
+///          if `libusb` had a problem.
+/// \returns \link HACKRF_ERROR_OTHER \endlink
+///          if something that should never happen happens.
+/// \returns \link HACKRF_SUCCESS \endlink otherwise.
+extern ADDAPI enum hackrf_error ADDCALL
+hackrf_start_tdd(hackrf_device*            device,
+                 hackrf_sample_block_cb_fn rx_callback,
+                 void*                     rx_ctx,
+                 hackrf_sample_block_cb_fn tx_callback,
+                 void*                     tx_ctx);
+
+/// \brief Turn a stream started with \link hackrf_start_tdd \endlink
+///        around.
+///
+/// Only the RF path and SGPIO direction change, the clock source and
+/// hardware sync setup are left as they are. After a switch to transmit
+/// the device sends silence until the first buffer from `tx_callback`
+/// reaches it.
+///
+/// \param device   FIXME: doc
+/// \param transmit non-zero to transmit, zero to receive
+/// \param cycles   if not NULL, receives the number of 204 MHz CPU cycles
+///                 the firmware spent switching
+///
+/// \returns \link HACKRF_ERROR_USB_API_VERSION \endlink
+///          if the HackRF USB API version is lower than `0x0104`.
+/// \returns \link HACKRF_ERROR_LIBUSB \endlink
+///          if `libusb` had a problem, or the device is not streaming.
+/// \returns \link HACKRF_SUCCESS \endlink otherwise.
+extern ADDAPI enum hackrf_error ADDCALL
+hackrf_switch_direction(hackrf_device* device,
+                        const uint8_t  transmit,
+                        uint32_t*      cycles);
+
+/// \brief FIXME: doc
+///
+/// \param device FIXME: doc
+///
+/// \returns \link HACKRF_ERROR_THREAD \endlink
+///          if `pthread_join`ing the transfer thread failed.
+/// \returns \link HACKRF_ERROR_LIBUSB \endlink
+///          if `libusb` had a problem.
+/// \returns \link HACKRF_SUCCESS \endlink otherwise.
+extern ADDAPI enum hackrf_error ADDCALL
+hackrf_stop_tdd(hackrf_device* device);
+
 /// \brief FIXME: doc
 ///
 /// FIXME: maybe this should return a different enum
@@ -778,6 +1233,144 @@ extern ADDAPI enum hackrf_error ADDCALL
 hackrf_set_sample_rate(hackrf_device* device,
                        double         freq_hz);
 
+/// \brief Find Si5351C settings for a sample rate.
+///
+/// Every R divider and multisynth fraction `a + b / c` (c below 2^20) is
+/// considered and the closest rate is returned as an exact fraction together
+/// with its error. An even integer divider is preferred when its error is
+/// within `integer_ppm`, as integer mode has less jitter. Nothing is sent to
+/// the device.
+///
+/// \param freq        requested sample rate in Hz
+/// \param integer_ppm error allowed to get integer mode, 0 to only take it when exact
+/// \param solution    receives the settings, see \link hackrf_sample_rate_solution \endlink
+///
+/// \returns \link HACKRF_ERROR_INVALID_PARAM \endlink
+///          if the rate cannot be generated.
+/// \returns \link HACKRF_SUCCESS \endlink otherwise.
+extern ADDAPI enum hackrf_error ADDCALL
+hackrf_compute_sample_rate(double                       freq,
+                           double                       integer_ppm,
+                           hackrf_sample_rate_solution* solution);
+
+/// \brief Program a sample rate found by hackrf_compute_sample_rate().
+///
+/// This function requires HackRF USB API version 0x0104 or higher
+///
+/// The multisynth registers are written as given, so the device runs at
+/// exactly `solution->rate_num / solution->rate_den`. The baseband filter is
+/// chosen as in hackrf_set_sample_rate().
+///
+/// \param device   FIXME: doc
+/// \param solution settings to program
+///
+/// \returns \link HACKRF_ERROR_USB_API_VERSION \endlink
+///          if the HackRF USB API version is lower than `0x0104`.
+/// \returns \link HACKRF_ERROR_LIBUSB \endlink
+///          if `libusb` had a problem.
+/// \returns \link HACKRF_SUCCESS \endlink otherwise.
+extern ADDAPI enum hackrf_error ADDCALL
+hackrf_set_sample_rate_solution(hackrf_device*                     device,
+                                const hackrf_sample_rate_solution* solution);
+
+/// \brief Set the sample rate as closely as the hardware allows.
+///
+/// Same as hackrf_compute_sample_rate() with no integer mode tolerance
+/// followed by hackrf_set_sample_rate_solution(). The last solution is kept
+/// with the device and reused when the same rate is requested again.
+///
+/// \param device   FIXME: doc
+/// \param freq     requested sample rate in Hz
+/// \param solution receives the rate actually programmed, may be NULL
+///
+/// \returns \link HACKRF_ERROR_INVALID_PARAM \endlink
+///          if the rate cannot be generated.
+/// \returns \link HACKRF_ERROR_USB_API_VERSION \endlink
+///          if the HackRF USB API version is lower than `0x0104`.
+/// \returns \link HACKRF_ERROR_LIBUSB \endlink
+///          if `libusb` had a problem.
+/// \returns \link HACKRF_SUCCESS \endlink otherwise.
+extern ADDAPI enum hackrf_error ADDCALL
+hackrf_set_sample_rate_exact(hackrf_device*               device,
+                             double                       freq,
+                             hackrf_sample_rate_solution* solution);
+
+/// \brief Apply several settings with one USB request.
+///
+/// This function requires HackRF USB API version 0x0104 or higher
+///
+/// The device applies the settings in the order that settles fastest:
+/// sample rate, baseband filter, frequency, then gains, amp and antenna. A
+/// setting the device rejects does not stop the others; use
+/// hackrf_get_config_result() to see which ones took effect.
+///
+/// \param device FIXME: doc
+/// \param config settings to apply, see \link hackrf_config \endlink
+///
+/// \returns \link HACKRF_ERROR_USB_API_VERSION \endlink
+///          if the HackRF USB API version is lower than `0x0104`.
+/// \returns \link HACKRF_ERROR_LIBUSB \endlink
+///          if `libusb` had a problem.
+/// \returns \link HACKRF_SUCCESS \endlink otherwise.
+extern ADDAPI enum hackrf_error ADDCALL
+hackrf_apply_config(hackrf_device*       device,
+                    const hackrf_config* config);
+
+/// \brief Read back the outcome of the last config bundle.
+///
+/// This function requires HackRF USB API version 0x0104 or higher
+///
+/// \param device FIXME: doc
+/// \param result receives the outcome, see \link hackrf_config_result \endlink
+///
+/// \returns \link HACKRF_ERROR_USB_API_VERSION \endlink
+///          if the HackRF USB API version is lower than `0x0104`.
+/// \returns \link HACKRF_ERROR_LIBUSB \endlink
+///          if `libusb` had a problem.
+/// \returns \link HACKRF_SUCCESS \endlink otherwise.
+extern ADDAPI enum hackrf_error ADDCALL
+hackrf_get_config_result(hackrf_device*        device,
+                         hackrf_config_result* result);
+
+/// \brief Change the sample rate while streaming.
+///
+/// This function requires HackRF USB API version 0x0104 or higher
+///
+/// The clock generator and baseband filter are reprogrammed without stopping
+/// the stream. The filter is chosen as in hackrf_set_sample_rate(). Samples
+/// from `change->glitch_start` up to `change->first_sample` were taken while
+/// the clock was being changed and should be discarded.
+///
+/// \param device FIXME: doc
+/// \param freq   new sample rate in Hz
+/// \param change receives where the change landed, may be NULL
+///
+/// \returns \link HACKRF_ERROR_USB_API_VERSION \endlink
+///          if the HackRF USB API version is lower than `0x0104`.
+/// \returns \link HACKRF_ERROR_LIBUSB \endlink
+///          if `libusb` had a problem.
+/// \returns \link HACKRF_SUCCESS \endlink otherwise.
+extern ADDAPI enum hackrf_error ADDCALL
+hackrf_set_sample_rate_in_stream(hackrf_device*      device,
+                                 double              freq,
+                                 hackrf_rate_change* change);
+
+/// \brief Read where the last in-stream sample rate change landed.
+///
+/// This function requires HackRF USB API version 0x0104 or higher
+///
+/// \param device FIXME: doc
+/// \param change receives the marker, see \link hackrf_rate_change \endlink
+///
+/// \returns \link HACKRF_ERROR_USB_API_VERSION \endlink
+///          if the HackRF USB API version is lower than `0x0104`.
+/// \returns \link HACKRF_ERROR_LIBUSB \endlink
+///          if `libusb` had a problem.
+/// \returns \link HACKRF_SUCCESS \endlink otherwise.
+extern ADDAPI enum hackrf_error ADDCALL
+hackrf_get_rate_change(hackrf_device*      device,
+                       hackrf_rate_change* change);
+
 /// \brief FIXME: doc
 ///
 /// external amp, bool on/off
@@ -932,6 +1525,275 @@ hackrf_init_sweep(hackrf_device*   device,
                   uint32_t         offset,
                   enum sweep_style style);
 
+/// \brief Start sweep mode with an explicit list of hop frequencies.
+///
+/// This function requires HackRF USB API version 0x0104 or higher
+///
+/// Unlike \link hackrf_init_sweep \endlink, every hop is given as an exact
+/// frequency in Hz with its own dwell time. The device cycles through the
+/// list without host intervention and tags each block with the frequency
+/// of its hop.
+///
+/// \param device   FIXME: doc
+/// \param hops     list of hops, see \link hackrf_sweep_hop \endlink
+/// \param num_hops number of entries in `hops`
+///
+/// \returns \link HACKRF_ERROR_INVALID_PARAM \endlink
+///          if `num_hops < 1`.
+/// \returns \link HACKRF_ERROR_INVALID_PARAM \endlink
+///          if `num_hops > MAX_SWEEP_HOPS`.
+/// \returns \link HACKRF_ERROR_INVALID_PARAM \endlink
+///          if any `num_bytes` is not a nonzero multiple of
+///          `BYTES_PER_BLOCK`, or exceeds 65535 blocks.
+/// \returns \link HACKRF_ERROR_USB_API_VERSION \endlink
+///          if the HackRF USB API version is lower than `0x0104`.
+/// \returns \link HACKRF_ERROR_LIBUSB \endlink
+///          if `libusb` had a problem.
+/// \returns \link HACKRF_SUCCESS \endlink otherwise.
+extern ADDAPI enum hackrf_error ADDCALL
+hackrf_init_sweep_hops(hackrf_device*          device,
+                       const hackrf_sweep_hop* hops,
+                       int                     num_hops);
+
+/// \brief Read retune timing measured by the device in sweep mode.
+///
+/// This function requires HackRF USB API version 0x0104 or higher
+///
+/// The device waits for PLL lock after each retune rather than discarding
+/// a fixed number of blocks. Use this to see how long that takes.
+///
+/// \param device FIXME: doc
+/// \param stats  receives the counters, see \link hackrf_sweep_stats \endlink
+///
+/// \returns \link HACKRF_ERROR_USB_API_VERSION \endlink
+///          if the HackRF USB API version is lower than `0x0104`.
+/// \returns \link HACKRF_ERROR_LIBUSB \endlink
+///          if `libusb` had a problem.
+/// \returns \link HACKRF_SUCCESS \endlink otherwise.
+extern ADDAPI enum hackrf_error ADDCALL
+hackrf_get_sweep_stats(hackrf_device*      device,
+                       hackrf_sweep_stats* stats);
+
+/// \brief Read the firmware's retune counters.
+///
+/// This function requires HackRF USB API version 0x0104 or higher
+///
+/// \param device FIXME: doc
+/// \param stats  receives the counters, see \link hackrf_tuning_stats \endlink
+///
+/// \returns \link HACKRF_ERROR_USB_API_VERSION \endlink
+///          if the HackRF USB API version is lower than `0x0104`.
+/// \returns \link HACKRF_ERROR_LIBUSB \endlink
+///          if `libusb` had a problem.
+/// \returns \link HACKRF_SUCCESS \endlink otherwise.
+extern ADDAPI enum hackrf_error ADDCALL
+hackrf_get_tuning_stats(hackrf_device*       device,
+                        hackrf_tuning_stats* stats);
+
+/// \brief Schedule a command to run at a given sample.
+///
+/// This function requires HackRF USB API version 0x0104 or higher
+///
+/// The device keeps up to 32 pending commands and runs each once the
+/// stream reaches `sample`, within a few tens of samples, independent of
+/// USB latency. Samples are counted as in \link hackrf_rate_change \endlink:
+/// complex samples since streaming was started, before decimation, carrying
+/// on across RX/TX switches. Starting or stopping streaming clears the
+/// queue. A command whose sample has already passed runs straight away.
+///
+/// \param device FIXME: doc
+/// \param sample stream position to run the command at
+/// \param type   what to do, see \link hackrf_scheduled_type \endlink
+/// \param arg    argument for `type`
+///
+/// \returns \link HACKRF_ERROR_USB_API_VERSION \endlink
+///          if the HackRF USB API version is lower than `0x0104`.
+/// \returns \link HACKRF_ERROR_LIBUSB \endlink
+///          if `libusb` had a problem, or the queue is full.
+/// \returns \link HACKRF_SUCCESS \endlink otherwise.
+extern ADDAPI enum hackrf_error ADDCALL
+hackrf_schedule_command(hackrf_device*             device,
+                        uint64_t                   sample,
+                        enum hackrf_scheduled_type type,
+                        uint64_t                   arg);
+
+/// \brief Schedule an Operacake port change at a given sample.
+///
+/// This function requires HackRF USB API version 0x0104 or higher
+///
+/// See hackrf_schedule_command() and hackrf_set_operacake_ports().
+///
+/// \param device  FIXME: doc
+/// \param sample  stream position to switch at
+/// \param address Operacake board address
+/// \param port_a  FIXME: doc
+/// \param port_b  FIXME: doc
+///
+/// \returns \link HACKRF_ERROR_USB_API_VERSION \endlink
+///          if the HackRF USB API version is lower than `0x0104`.
+/// \returns \link HACKRF_ERROR_LIBUSB \endlink
+///          if `libusb` had a problem, or the queue is full.
+/// \returns \link HACKRF_SUCCESS \endlink otherwise.
+extern ADDAPI enum hackrf_error ADDCALL
+hackrf_schedule_operacake_ports(hackrf_device* device,
+                                uint64_t       sample,
+                                uint8_t        address,
+                                uint8_t        port_a,
+                                uint8_t        port_b);
+
+/// \brief Drop all pending scheduled commands and reset their counters.
+///
+/// This function requires HackRF USB API version 0x0104 or higher
+///
+/// \param device FIXME: doc
+///
+/// \returns \link HACKRF_ERROR_USB_API_VERSION \endlink
+///          if the HackRF USB API version is lower than `0x0104`.
+/// \returns \link HACKRF_ERROR_LIBUSB \endlink
+///          if `libusb` had a problem.
+/// \returns \link HACKRF_SUCCESS \endlink otherwise.
+extern ADDAPI enum hackrf_error ADDCALL
+hackrf_clear_schedule(hackrf_device* device);
+
+/// \brief Read the firmware's scheduled command counters.
+///
+/// This function requires HackRF USB API version 0x0104 or higher
+///
+/// \param device FIXME: doc
+/// \param stats  receives the counters, see \link hackrf_schedule_stats \endlink
+///
+/// \returns \link HACKRF_ERROR_USB_API_VERSION \endlink
+///          if the HackRF USB API version is lower than `0x0104`.
+/// \returns \link HACKRF_ERROR_LIBUSB \endlink
+///          if `libusb` had a problem.
+/// \returns \link HACKRF_SUCCESS \endlink otherwise.
+extern ADDAPI enum hackrf_error ADDCALL
+hackrf_get_schedule_stats(hackrf_device*         device,
+                          hackrf_schedule_stats* stats);
+
+/// \brief Read the firmware's CPU idle counters.
+///
+/// This function requires HackRF USB API version 0x0104 or higher
+///
+/// \param device FIXME: doc
+/// \param idle   receives the counters, see \link hackrf_cpu_idle \endlink
+///
+/// \returns \link HACKRF_ERROR_USB_API_VERSION \endlink
+///          if the HackRF USB API version is lower than `0x0104`.
+/// \returns \link HACKRF_ERROR_LIBUSB \endlink
+///          if `libusb` had a problem.
+/// \returns \link HACKRF_SUCCESS \endlink otherwise.
+extern ADDAPI enum hackrf_error ADDCALL
+hackrf_get_cpu_idle(hackrf_device*   device,
+                    hackrf_cpu_idle* idle);
+
+/// \brief Read the device's USB error counters.
+///
+/// This function requires HackRF USB API version 0x0104 or higher
+///
+/// A failed transfer is dropped and the endpoint is restarted rather than
+/// hanging the device. Any samples in the transfer are lost.
+///
+/// \param device FIXME: doc
+/// \param errors receives the counters, see \link hackrf_usb_errors \endlink
+///
+/// \returns \link HACKRF_ERROR_USB_API_VERSION \endlink
+///          if the HackRF USB API version is lower than `0x0104`.
+/// \returns \link HACKRF_ERROR_LIBUSB \endlink
+///          if `libusb` had a problem.
+/// \returns \link HACKRF_SUCCESS \endlink otherwise.
+extern ADDAPI enum hackrf_error ADDCALL
+hackrf_get_usb_errors(hackrf_device*     device,
+                      hackrf_usb_errors* errors);
+
+/// \brief Read the device's sample buffer ring counters.
+///
+/// This function requires HackRF USB API version 0x0104 or higher
+///
+/// \param device FIXME: doc
+/// \param stats  receives the counters, see \link hackrf_buffer_stats \endlink
+///
+/// \returns \link HACKRF_ERROR_USB_API_VERSION \endlink
+///          if the HackRF USB API version is lower than `0x0104`.
+/// \returns \link HACKRF_ERROR_LIBUSB \endlink
+///          if `libusb` had a problem.
+/// \returns \link HACKRF_SUCCESS \endlink otherwise.
+extern ADDAPI enum hackrf_error ADDCALL
+hackrf_get_buffer_stats(hackrf_device*       device,
+                        hackrf_buffer_stats* stats);
+
+/// \brief Decimate received samples on the device.
+///
+/// This function requires HackRF USB API version 0x0104 or higher
+///
+/// The device mixes the channel at `nco_freq_hz` from the tuned frequency
+/// down to DC, then reduces the sample rate by `ratio` with a third order
+/// CIC filter. Received data is then in `format` at `sample_rate_hz / ratio`.
+/// Only receive is affected, and it can only be changed while the
+/// transceiver is off. Decimation needs `sample_rate_hz` to be no more than
+/// `HACKRF_DECIMATION_MAX_INPUT_RATE`, and while it is enabled the device
+/// refuses sample rates above that.
+///
+/// \param device         FIXME: doc
+/// \param ratio          decimation ratio between `HACKRF_DECIMATION_MIN`
+///                       and `HACKRF_DECIMATION_MAX`, 0 or 1 disables
+/// \param format         output sample format
+/// \param nco_freq_hz    offset of the wanted channel from the tuned frequency
+/// \param sample_rate_hz sample rate the device is set to
+///
+/// \returns \link HACKRF_ERROR_USB_API_VERSION \endlink
+///          if the HackRF USB API version is lower than `0x0104`.
+/// \returns \link HACKRF_ERROR_INVALID_PARAM \endlink
+///          if `ratio`, `format` or `sample_rate_hz` are out of range.
+/// \returns \link HACKRF_ERROR_LIBUSB \endlink
+///          if `libusb` had a problem, including the device refusing the
+///          change while streaming.
+/// \returns \link HACKRF_SUCCESS \endlink otherwise.
+extern ADDAPI enum hackrf_error ADDCALL
+hackrf_set_decimation(hackrf_device*            device,
+                      uint32_t                  ratio,
+                      enum hackrf_sample_format format,
+                      double                    nco_freq_hz,
+                      double                    sample_rate_hz);
+
+/// \brief Query which sample formats the device can produce.
+///
+/// This function requires HackRF USB API version 0x0104 or higher
+///
+/// \param device  FIXME: doc
+/// \param formats receives a bitmask with bit `1 << format` set for each
+///                supported \link hackrf_sample_format \endlink
+///
+/// \returns \link HACKRF_ERROR_USB_API_VERSION \endlink
+///          if the HackRF USB API version is lower than `0x0104`.
+/// \returns \link HACKRF_ERROR_LIBUSB \endlink
+///          if `libusb` had a problem.
+/// \returns \link HACKRF_SUCCESS \endlink otherwise.
+extern ADDAPI enum hackrf_error ADDCALL
+hackrf_get_sample_formats(hackrf_device* device,
+                          uint32_t*      formats);
+
+/// \brief Expand received samples to interleaved 16-bit I and Q.
+///
+/// Values keep the scale of the source format, so cs8 comes out in
+/// -128..127 and cs12 in -2048..2047.
+/// A transfer buffer may end part way through a packed cs12 sample. Only
+/// whole samples are converted; carry the remaining bytes over to the
+/// start of the next buffer.
+///
+/// \param format the format `in` is in
+/// \param in     received bytes
+/// \param length number of bytes in `in`
+/// \param out    receives two values per sample, room for `length` values
+///               is always enough
+///
+/// \returns the number of bytes of `in` consumed.
+extern ADDAPI size_t ADDCALL
+hackrf_unpack_samples(enum hackrf_sample_format format,
+                      const uint8_t*            in,
+                      size_t                    length,
+                      int16_t*                  out);
+
 // -----------------------------------------------------------------------------
 // ---- Enum-to-string conversion functions ------------------------------------
 // -----------------------------------------------------------------------------
@@ -0,0 +1,187 @@
+// -----------------------------------------------------------------------------
+// -----------------------------------------------------------------------------
+// -----------------------------------------------------------------------------
+
+// Copyright (c) 2017, Great Scott Gadgets
+//
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+// 3. Neither the name of Great Scott Gadgets nor the names of its contributors
+//    may be used to endorse or promote products derived from this software
+//    without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+// -----------------------------------------------------------------------------
+// -----------------------------------------------------------------------------
+// -----------------------------------------------------------------------------
+
+
+// Checks hackrf_compute_sample_rate() without a device: known rates come
+// out exact, every solution's rate_num / rate_den is exactly what its
+// register values produce, and the register values are in range.
+
+#include "hackrf.h"
+
+#include <inttypes.h>
+#include <math.h>
+#include <stdio.h>
+
+#define VCO_HZ 800000000ULL
+#define P1_LIMIT (1UL << 18)
+#define P3_LIMIT (1UL << 20)
+
+static int failures = 0;
+
+static uint64_t gcd64(uint64_t u, uint64_t v) {
+    while(v) {
+        uint64_t t = u % v;
+        u = v;
+        v = t;
+    }
+    return u;
+}
+
+// Rate the registers actually give, reduced: MS0 divides by
+// (p1 + 512 + p2 / p3) / 128 and the R divider and CLK0 by 2^(r_div + 1).
+static void register_rate(const hackrf_sample_rate_solution* s,
+                          uint64_t*                          num,
+                          uint64_t*                          den) {
+    uint64_t n = VCO_HZ * 128 * s->p3;
+    uint64_t d = ((uint64_t)(s->p1 + 512) * s->p3 + s->p2) << (s->r_div + 1);
+    uint64_t g = gcd64(n, d);
+
+    *num = n / g;
+    *den = d / g;
+}
+
+static void fail(const char* what, double freq) {
+    printf("FAIL %s at %.6f Hz\n", what, freq);
+    failures++;
+}
+
+// Checks common to every solution, returns the solution for further checks.
+static hackrf_sample_rate_solution check_rate(double freq, double integer_ppm) {
+    hackrf_sample_rate_solution s;
+    uint64_t num, den;
+
+    if(hackrf_compute_sample_rate(freq, integer_ppm, &s) != HACKRF_SUCCESS) {
+        fail("no solution", freq);
+        return s;
+    }
+
+    if(s.p1 >= P1_LIMIT) {
+        fail("p1 out of range", freq);
+    }
+    if(s.p3 == 0 || s.p3 >= P3_LIMIT) {
+        fail("p3 out of range", freq);
+    }
+    if(s.p2 >= s.p3) {
+        fail("p2 not below p3", freq);
+    }
+    if(s.r_div > 6) {
+        fail("r_div out of range", freq);
+    }
+    if(s.rate_den == 0 || gcd64(s.rate_num, s.rate_den) != 1) {
+        fail("rate not reduced", freq);
+    }
+
+    register_rate(&s, &num, &den);
+    if(num != s.rate_num || den != s.rate_den) {
+        fail("rate does not match registers", freq);
+    }
+
+    if(fabs(((double)s.rate_num / s.rate_den - freq) * 1e6 / freq - s.ppm_error) > 1e-6) {
+        fail("ppm_error wrong", freq);
+    }
+    return s;
+}
+
+static void check_exact(double freq, uint64_t num, uint64_t den, int integer_mode) {
+    hackrf_sample_rate_solution s = check_rate(freq, 0.0);
+
+    if(s.rate_num != num || s.rate_den != den) {
+        printf("     got %" PRIu64 "/%" PRIu64 ", want %" PRIu64 "/%" PRIu64 "\n",
+               s.rate_num, s.rate_den, num, den);
+        fail("not exact", freq);
+    }
+    if(s.ppm_error != 0.0) {
+        fail("nonzero ppm_error for an exact rate", freq);
+    }
+    if(s.integer_mode != integer_mode) {
+        fail("wrong integer mode", freq);
+    }
+}
+
+int main(void) {
+    hackrf_sample_rate_solution s;
+    double freq;
+    int i;
+
+    // Rates the old integer divider code could not reach exactly.
+    check_exact(9216000.0, 9216000, 1, 0);
+    check_exact(18432000.0, 18432000, 1, 0);
+    check_exact(10e6 / 3, 10000000, 3, 1);
+
+    // Even dividers, integer mode without any tolerance.
+    check_exact(20e6, 20000000, 1, 1);
+    check_exact(10e6, 10000000, 1, 1);
+
+    // A divider of 50.05 is 1000 ppm from integer mode: taken when 2000 ppm
+    // is allowed, not when none is.
+    freq = VCO_HZ / 2 / 50.05;
+    s = check_rate(freq, 2000.0);
+    if(!s.integer_mode || s.p3 != 1) {
+        fail("integer mode not taken within tolerance", freq);
+    }
+    s = check_rate(freq, 0.0);
+    if(s.integer_mode) {
+        fail("integer mode taken outside tolerance", freq);
+    }
+
+    // Every rate the R dividers cover, down to 800 MHz / (2 * 2^6 * 2048).
+    for(freq = 3100.0; freq <= 50e6; freq *= 1.0137) {
+        s = check_rate(freq, 0.0);
+        if(fabs(s.ppm_error) > 0.01) {
+            fail("more than 0.01 ppm off", freq);
+        }
+    }
+    for(i = 1; i <= 20000; i++) {
+        check_rate(1e6 + i * 997.3, 0.0);
+    }
+
+    if(hackrf_compute_sample_rate(0.0, 0.0, &s) != HACKRF_ERROR_INVALID_PARAM) {
+        fail("zero rate accepted", 0.0);
+    }
+    if(hackrf_compute_sample_rate(3000.0, 0.0, &s) != HACKRF_ERROR_INVALID_PARAM) {
+        fail("rate below the R divider range accepted", 3000.0);
+    }
+    if(hackrf_compute_sample_rate(60e6, 0.0, &s) != HACKRF_ERROR_INVALID_PARAM) {
+        fail("rate above the multisynth range accepted", 60e6);
+    }
+
+    if(failures) {
+        printf("%d failures\n", failures);
+        return 1;
+    }
+    printf("ok\n");
+    return 0;
+}